@@ -15,3 +15,6 @@ make load NUM_DEVICES=2
 cd ../video-sim
 make
 make load NUM_DEVICES=2
+cd ../plc-sim
+make
+make load NUM_DEVICES=1
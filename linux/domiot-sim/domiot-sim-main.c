@@ -0,0 +1,117 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+// All the simulators in one module, so that a test environment comes up
+// with a single insmod. Each simulator is compiled from its own source (see
+// ihubx24.c and the others) and initialized here in turn.
+
+#define DEVICE_NAME "domiot-sim"
+
+// device count of each simulator, read by its init
+int domiot_sim_ihub = 1;
+module_param_named(ihub, domiot_sim_ihub, int, S_IRUGO);
+MODULE_PARM_DESC(ihub, "Number of ihubx24-sim devices to create at load time (default: 1, max: 1024)");
+
+int domiot_sim_ohub = 1;
+module_param_named(ohub, domiot_sim_ohub, int, S_IRUGO);
+MODULE_PARM_DESC(ohub, "Number of ohubx24-sim devices to create at load time (default: 1, max: 1024)");
+
+int domiot_sim_iohub = 1;
+module_param_named(iohub, domiot_sim_iohub, int, S_IRUGO);
+MODULE_PARM_DESC(iohub, "Number of iohubx24-sim devices to create at load time (default: 1, max: 1024)");
+
+int domiot_sim_lcd = 1;
+module_param_named(lcd, domiot_sim_lcd, int, S_IRUGO);
+MODULE_PARM_DESC(lcd, "Number of lcd-sim devices to create at load time (default: 1, max: 1024)");
+
+int domiot_sim_video = 1;
+module_param_named(video, domiot_sim_video, int, S_IRUGO);
+MODULE_PARM_DESC(video, "Number of video-sim devices to create at load time (default: 1, max: 1024)");
+
+int domiot_sim_plc = 1;
+module_param_named(plc, domiot_sim_plc, int, S_IRUGO);
+MODULE_PARM_DESC(plc, "Number of plc-sim devices to create at load time (default: 1, max: 1024)");
+
+// defined by DSIM_MODULE() in each simulator
+int ihub_bundle_init(void);
+void ihub_bundle_exit(void);
+int ohub_bundle_init(void);
+void ohub_bundle_exit(void);
+int iohub_bundle_init(void);
+void iohub_bundle_exit(void);
+int lcd_bundle_init(void);
+void lcd_bundle_exit(void);
+int video_bundle_init(void);
+void video_bundle_exit(void);
+int plc_bundle_init(void);
+void plc_bundle_exit(void);
+
+static int __init domiot_sim_init(void)
+{
+    int result;
+
+    result = ihub_bundle_init();
+    if (result) {
+        goto fail;
+    }
+    result = ohub_bundle_init();
+    if (result) {
+        goto cleanup_ihub;
+    }
+    result = iohub_bundle_init();
+    if (result) {
+        goto cleanup_ohub;
+    }
+    result = lcd_bundle_init();
+    if (result) {
+        goto cleanup_iohub;
+    }
+    result = video_bundle_init();
+    if (result) {
+        goto cleanup_lcd;
+    }
+    result = plc_bundle_init();
+    if (result) {
+        goto cleanup_video;
+    }
+
+    printk(KERN_INFO DEVICE_NAME ": Loaded ihub=%d ohub=%d iohub=%d lcd=%d video=%d plc=%d\n",
+           domiot_sim_ihub, domiot_sim_ohub, domiot_sim_iohub, domiot_sim_lcd, domiot_sim_video,
+           domiot_sim_plc);
+    return 0;
+
+cleanup_video:
+    video_bundle_exit();
+cleanup_lcd:
+    lcd_bundle_exit();
+cleanup_iohub:
+    iohub_bundle_exit();
+cleanup_ohub:
+    ohub_bundle_exit();
+cleanup_ihub:
+    ihub_bundle_exit();
+fail:
+    printk(KERN_ERR DEVICE_NAME ": Failed to load (%d)\n", result);
+    return result;
+}
+
+static void __exit domiot_sim_exit(void)
+{
+    // the PLCs stop before the simulators they drive go away
+    plc_bundle_exit();
+    video_bundle_exit();
+    lcd_bundle_exit();
+    iohub_bundle_exit();
+    ohub_bundle_exit();
+    ihub_bundle_exit();
+    printk(KERN_INFO DEVICE_NAME ": Unloaded\n");
+}
+
+module_init(domiot_sim_init);
+module_exit(domiot_sim_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("DOMIoT");
+MODULE_DESCRIPTION("All DOMIoT simulators in one module.");
+MODULE_VERSION("1.0.0");
@@ -0,0 +1,3 @@
+// ihubx24-sim built into domiot-sim.ko, its parameters are named ihub.*
+#define DSIM_PARAM_PREFIX "ihub."
+#include "../ihubx24-sim/ihubx24-sim-main.c"
@@ -0,0 +1,3 @@
+// iohubx24-sim built into domiot-sim.ko, its parameters are named iohub.*
+#define DSIM_PARAM_PREFIX "iohub."
+#include "../iohubx24-sim/iohubx24-sim-main.c"
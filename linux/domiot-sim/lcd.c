@@ -0,0 +1,3 @@
+// lcd-sim built into domiot-sim.ko, its parameters are named lcd.*
+#define DSIM_PARAM_PREFIX "lcd."
+#include "../lcd-sim/lcd-sim.c"
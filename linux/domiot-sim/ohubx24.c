@@ -0,0 +1,3 @@
+// ohubx24-sim built into domiot-sim.ko, its parameters are named ohub.*
+#define DSIM_PARAM_PREFIX "ohub."
+#include "../ohubx24-sim/ohubx24-sim.c"
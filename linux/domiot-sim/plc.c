@@ -0,0 +1,3 @@
+// plc-sim built into domiot-sim.ko, its parameters are named plc.*
+#define DSIM_PARAM_PREFIX "plc."
+#include "../plc-sim/plc-sim.c"
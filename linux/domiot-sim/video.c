@@ -0,0 +1,3 @@
+// video-sim built into domiot-sim.ko, its parameters are named video.*
+#define DSIM_PARAM_PREFIX "video."
+#include "../video-sim/video-sim-main.c"
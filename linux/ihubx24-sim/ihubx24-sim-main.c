@@ -0,0 +1,1798 @@
+#include <linux/init.h>
+#include <linux/version.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/random.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+#include <linux/prandom.h>
+#endif
+#include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/list.h>
+#include <linux/atomic.h>
+#include <linux/slab.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/firmware.h>
+#include <linux/idr.h>
+#include <linux/uio.h>
+#include <linux/seqlock.h>
+#include <linux/percpu.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-events.h"
+#include "ihubx24-sim.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
+#define DEVICE_NAME "ihubx24-sim"
+#define CLASS_NAME "ihubx24"
+#define NUM_INPUTS 24
+#define BUFFER_SIZE (NUM_INPUTS + 1)
+#define INPUTS_MASK GENMASK(NUM_INPUTS - 1, 0)
+#define MAX_DEVICES 1024
+// /dev/ihubx24-sim-all follows the minors of the devices
+#define ALL_MINOR MAX_DEVICES
+// a snapshot is taken again while devices change under it, this many times
+#define SNAPSHOT_PASSES 4
+#define MIN_PERIOD_US 1ULL
+#define MAX_PERIOD_US (3600ULL * USEC_PER_SEC)
+#define TRACE_NAME_SIZE 64
+#define TRACE_BATCH 64
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+    #define HRTIMER_SETUP_COMPAT(timer, fn, clock, mode) hrtimer_setup(timer, fn, clock, mode)
+#else
+    #define HRTIMER_SETUP_COMPAT(timer, fn, clock, mode) do { \
+        hrtimer_init(timer, clock, mode); \
+        (timer)->function = fn; \
+    } while(0)
+#endif
+
+// debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
+static int debug_level = 1;
+module_param(debug_level, int, 0644);
+MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
+
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the ihub parameter of domiot-sim.ko
+extern int domiot_sim_ihub;
+#define num_devices domiot_sim_ihub
+#else
+static int num_devices = 1;
+module_param(num_devices, int, 0644);
+MODULE_PARM_DESC(num_devices, "Number of ihubx24-sim devices to create at load time (default: 1, max: 1024)");
+#endif
+
+static unsigned int queue_size = 0;
+module_param(queue_size, uint, 0644);
+MODULE_PARM_DESC(queue_size, "Per-reader event queue length, 0 = latest state only (default: 0)");
+
+static unsigned long long period_us = 10 * USEC_PER_SEC;
+module_param(period_us, ullong, S_IRUGO);
+MODULE_PARM_DESC(period_us, "Initial input update period in microseconds (default: 10000000, max: 3600000000)");
+
+static unsigned long long seed = 0;
+module_param(seed, ullong, S_IRUGO);
+MODULE_PARM_DESC(seed, "Input generator seed, device N uses seed+N, 0 = random (default: 0)");
+
+// operation counters, per CPU so that the timer and the readers never share
+// a cache line; the stats attributes sum them over all CPUs
+struct ihubx24_stats {
+    u64 reads;
+    u64 bytes_out;
+    u64 state_changes;
+    u64 wakeups;
+    u64 eagain;
+    u64 dropped;        // events lost to full reader queues
+    u64 conflated;      // changes a latest state reader never saw
+    u64 filtered;       // changes a masked reader was not woken for
+};
+
+// an input wired to output channel 'output' of a source device, source is
+// DSIM_WIRE_OHUBX24, DSIM_WIRE_IOHUBX24 or 0 when the input is not wired
+struct ihubx24_wire {
+    u8 source;
+    u8 output;
+    u16 minor;
+};
+
+struct ihubx24_device {
+    int device_id;
+    struct device *device;
+    // open files, delete_device is refused while non-zero
+    unsigned int open_count;
+    struct hrtimer input_timer;
+    u64 period_ns;
+    // achieved update rate, maintained by the timer callback
+    u64 rate_window_start;
+    u64 rate_window_ticks;
+    u64 rate_mhz;
+    u64 overruns;
+    // deterministic input generator, the same seed replays the same inputs
+    struct rnd_state rng;
+    u64 seed;
+    // trace replay, replaces the generator while a trace is loaded
+    const struct firmware *trace_fw;
+    const struct ihubx24_trace_record *trace_records;
+    u32 trace_count;
+    u32 trace_pos;
+    unsigned int trace_speed;
+    bool trace_loop;
+    bool trace_playing;
+    bool trace_waiting;
+    char trace_name[TRACE_NAME_SIZE];
+    // serializes sysfs control of input_timer and the trace
+    struct mutex timer_mutex;
+    // serializes input changes between the timer and the wiring
+    spinlock_t input_lock;
+    char input_states[NUM_INPUTS];
+    char prev_input_states[NUM_INPUTS];
+    // inputs driven by the wiring, wired_mask and wired_state are changed
+    // under wiring_lock and input_lock; the device is on wired_devices
+    // while it has wired inputs
+    struct ihubx24_wire wires[NUM_INPUTS];
+    u32 wired_mask;
+    u32 wired_state;
+    struct list_head wired_list;
+    // readers sleep until the generation moves past their seen_generation
+    struct dsim_notifier notify;
+    // time, number and state of the last change for record reads, written
+    // under readers_lock
+    seqcount_t change_seqcount;
+    u64 change_ns;
+    u64 change_seq;
+    u32 change_state;
+    // all readers, the queued ones that get an event per change and the
+    // ones with an input mask that are woken one by one
+    struct list_head readers_list;
+    struct list_head queued_readers_list;
+    struct list_head masked_readers_list;
+    spinlock_t readers_lock;
+    struct ihubx24_stats __percpu *stats;
+};
+
+static int major_number;
+static struct class *ihubx24_sim_class = NULL;
+// readers are allocated on every open, from a dedicated cache
+static struct kmem_cache *reader_cache;
+static struct device *all_device;
+// any change of any device, for the aggregate file
+static struct dsim_fleet fleet;
+// devices by minor, devices_mutex protects the table and open_count
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
+// state change events of all the devices, see domiot-sim-events.h
+static struct dsim_events *event_bus;
+// devices with wired inputs, visited on every output change of a source
+static LIST_HEAD(wired_devices);
+static DEFINE_SPINLOCK(wiring_lock);
+
+struct ihubx24_sim_reader {
+    struct list_head list;
+    struct list_head queued_list;
+    // NULL for readers of the aggregate file
+    struct ihubx24_device *device;
+    // latest state mode only: generation returned by the last read and
+    // IHUBX24_READ_TEXT or IHUBX24_READ_RECORD
+    u64 seen_generation;
+    unsigned int read_mode;
+    // set by IHUBX24_IOC_SET_MASK: the reader then sleeps on its own
+    // waitqueue and is woken, with wanted_generation moved to the change,
+    // only when one of the inputs in mask changed
+    struct list_head masked_list;
+    bool masked;
+    u32 mask;
+    u64 wanted_generation;
+    wait_queue_head_t wait;
+    // queued mode only: events are produced under readers_lock and
+    // consumed under read_mutex
+    DECLARE_KFIFO_PTR(events, struct ihubx24_event);
+    unsigned int dropped;
+    struct mutex read_mutex;
+};
+
+static int dev_open(struct inode *, struct file *);
+static int dev_release(struct inode *, struct file *);
+static ssize_t dev_read_iter(struct kiocb *, struct iov_iter *);
+static unsigned int dev_poll(struct file *filep, struct poll_table_struct *wait);
+static long dev_ioctl(struct file *, unsigned int, unsigned long);
+
+static struct file_operations fops = {
+    .owner = THIS_MODULE,
+    .open = dev_open,
+    .read_iter = dev_read_iter,
+    .release = dev_release,
+    .poll = dev_poll,
+    .unlocked_ioctl = dev_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+};
+
+static int all_open(struct inode *, struct file *);
+static int all_release(struct inode *, struct file *);
+static ssize_t all_read_iter(struct kiocb *, struct iov_iter *);
+static unsigned int all_poll(struct file *, struct poll_table_struct *);
+
+static struct file_operations all_fops = {
+    .owner = THIS_MODULE,
+    .open = all_open,
+    .read_iter = all_read_iter,
+    .release = all_release,
+    .poll = all_poll,
+};
+
+static ssize_t period_us_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t period_us_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t rate_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t seed_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t seed_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+
+static ssize_t trace_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t trace_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t trace_control_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t trace_control_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t trace_speed_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t trace_speed_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t trace_loop_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t trace_loop_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t trace_position_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t wiring_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t wiring_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+
+static DEVICE_ATTR(period_us, 0664, period_us_show, period_us_store);
+static DEVICE_ATTR(rate, 0444, rate_show, NULL);
+static DEVICE_ATTR(seed, 0664, seed_show, seed_store);
+static DEVICE_ATTR(trace, 0664, trace_show, trace_store);
+static DEVICE_ATTR(trace_control, 0664, trace_control_show, trace_control_store);
+static DEVICE_ATTR(trace_speed, 0664, trace_speed_show, trace_speed_store);
+static DEVICE_ATTR(trace_loop, 0664, trace_loop_show, trace_loop_store);
+static DEVICE_ATTR(trace_position, 0444, trace_position_show, NULL);
+static DEVICE_ATTR(wiring, 0664, wiring_show, wiring_store);
+
+static struct attribute *ihubx24_attrs[] = {
+    &dev_attr_period_us.attr,
+    &dev_attr_rate.attr,
+    &dev_attr_seed.attr,
+    &dev_attr_trace.attr,
+    &dev_attr_trace_control.attr,
+    &dev_attr_trace_speed.attr,
+    &dev_attr_trace_loop.attr,
+    &dev_attr_trace_position.attr,
+    &dev_attr_wiring.attr,
+    NULL,
+};
+
+static const struct attribute_group ihubx24_attr_group = {
+    .attrs = ihubx24_attrs,
+};
+
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct ihubx24_device, struct ihubx24_stats, field)
+
+STATS_ATTR(reads);
+STATS_ATTR(bytes_out);
+STATS_ATTR(state_changes);
+STATS_ATTR(wakeups);
+STATS_ATTR(eagain);
+STATS_ATTR(dropped);
+STATS_ATTR(conflated);
+STATS_ATTR(filtered);
+
+static struct attribute *ihubx24_stats_attrs[] = {
+    &dev_attr_stats_reads.attr,
+    &dev_attr_stats_bytes_out.attr,
+    &dev_attr_stats_state_changes.attr,
+    &dev_attr_stats_wakeups.attr,
+    &dev_attr_stats_eagain.attr,
+    &dev_attr_stats_dropped.attr,
+    &dev_attr_stats_conflated.attr,
+    &dev_attr_stats_filtered.attr,
+    NULL,
+};
+
+// /sys/class/ihubx24/ihubx24-simN/stats/
+static const struct attribute_group ihubx24_stats_group = {
+    .name = "stats",
+    .attrs = ihubx24_stats_attrs,
+};
+
+static const struct attribute_group *ihubx24_attr_groups[] = {
+    &ihubx24_attr_group,
+    &ihubx24_stats_group,
+    NULL,
+};
+
+static void set_input_states(char *states, u32 mask)
+{
+    int i;
+    
+    for (i = 0; i < NUM_INPUTS; i++) {
+        states[i] = (mask & BIT(i)) ? '1' : '0';
+    }
+}
+
+// wired inputs keep the state of their source, caller holds input_lock
+static inline u32 wired_inputs(struct ihubx24_device *dev, u32 state)
+{
+    return (state & ~dev->wired_mask) | (dev->wired_state & dev->wired_mask);
+}
+
+// reseed the generator and draw the first input states from it
+static void seed_input_states(struct ihubx24_device *dev, u64 new_seed)
+{
+    dev->seed = new_seed;
+    prandom_seed_state(&dev->rng, new_seed);
+    set_input_states(dev->input_states, wired_inputs(dev, prandom_u32_state(&dev->rng) & INPUTS_MASK));
+    memcpy(dev->prev_input_states, dev->input_states, NUM_INPUTS);
+}
+
+static u32 input_states_mask(const char *states)
+{
+    u32 mask = 0;
+    int i;
+    
+    for (i = 0; i < NUM_INPUTS; i++) {
+        if (states[i] == '1') {
+            mask |= BIT(i);
+        }
+    }
+    return mask;
+}
+
+static inline bool reader_queued(struct ihubx24_sim_reader *reader)
+{
+    return kfifo_initialized(&reader->events);
+}
+
+static inline bool reader_has_data(struct ihubx24_sim_reader *reader)
+{
+    if (reader_queued(reader)) {
+        return !kfifo_is_empty(&reader->events);
+    }
+    if (READ_ONCE(reader->masked)) {
+        return (s64)(READ_ONCE(reader->wanted_generation) - READ_ONCE(reader->seen_generation)) > 0;
+    }
+    return dsim_pending(&reader->device->notify, READ_ONCE(reader->seen_generation));
+}
+
+static inline wait_queue_head_t *reader_wait(struct ihubx24_sim_reader *reader)
+{
+    return READ_ONCE(reader->masked) ? &reader->wait : &reader->device->notify.wait;
+}
+
+// caller holds readers_lock
+static void reader_queue_event(struct ihubx24_sim_reader *reader, u64 timestamp_ns, u32 state)
+{
+    struct ihubx24_event event;
+    
+    if (kfifo_is_full(&reader->events)) {
+        reader->dropped++;
+        this_cpu_inc(reader->device->stats->dropped);
+        return;
+    }
+    
+    event.timestamp_ns = timestamp_ns;
+    event.state = state;
+    event.dropped = reader->dropped;
+    reader->dropped = 0;
+    kfifo_put(&reader->events, event);
+}
+
+// caller holds readers_lock, changes are numbered like the generation
+static void record_change(struct ihubx24_device *dev, u64 timestamp_ns, u32 state)
+{
+    write_seqcount_begin(&dev->change_seqcount);
+    dev->change_ns = timestamp_ns;
+    dev->change_seq = dsim_generation(&dev->notify) + 1;
+    dev->change_state = state;
+    write_seqcount_end(&dev->change_seqcount);
+}
+
+// latest state readers cost one increment and one wakeup, only queued
+// readers are visited to record the event
+static void notify_readers(struct ihubx24_device *dev)
+{
+    struct ihubx24_sim_reader *reader;
+    u64 now = ktime_get_ns();
+    u32 state = input_states_mask(dev->input_states);
+    u32 changed;
+    u64 generation;
+    
+    spin_lock(&dev->readers_lock);
+    changed = dev->change_state ^ state;
+    record_change(dev, now, state);
+    trace_ihubx24_sim_state_change(dev->device_id, state, dev->change_seq);
+    dsim_event(event_bus, dev->device_id, dev->change_seq, now, state);
+    list_for_each_entry(reader, &dev->queued_readers_list, queued_list) {
+        reader_queue_event(reader, now, state);
+    }
+    // fully ordered, input_states is visible before the new generation;
+    // published under readers_lock so that a masked reader woken below
+    // reads this change
+    generation = dsim_publish(&dev->notify);
+    list_for_each_entry(reader, &dev->masked_readers_list, masked_list) {
+        if (changed & reader->mask) {
+            // the change the reader was woken for is replaced unread
+            if ((s64)(reader->wanted_generation - READ_ONCE(reader->seen_generation)) > 0) {
+                this_cpu_inc(dev->stats->conflated);
+            }
+            WRITE_ONCE(reader->wanted_generation, generation);
+            wake_up_interruptible(&reader->wait);
+        } else {
+            this_cpu_inc(dev->stats->filtered);
+        }
+    }
+    spin_unlock(&dev->readers_lock);
+    
+    dsim_fleet_publish(&fleet);
+    this_cpu_inc(dev->stats->state_changes);
+    this_cpu_inc(dev->stats->wakeups);
+    dsim_wake(&dev->notify);
+    dsim_fleet_wake(&fleet);
+}
+
+// set the inputs that are not wired to state and notify the readers if
+// anything changed, caller holds input_lock
+static void apply_input_states(struct ihubx24_device *dev, u32 state)
+{
+    memcpy(dev->prev_input_states, dev->input_states, NUM_INPUTS);
+    set_input_states(dev->input_states, wired_inputs(dev, state));
+    if (memcmp(dev->input_states, dev->prev_input_states, NUM_INPUTS) != 0) {
+        notify_readers(dev);
+    }
+}
+
+// account one update in the achieved rate, recomputed about once per second
+static void update_rate(struct ihubx24_device *dev, u64 now)
+{
+    u64 elapsed = now - dev->rate_window_start;
+    
+    dev->rate_window_ticks++;
+    if (elapsed >= NSEC_PER_SEC) {
+        WRITE_ONCE(dev->rate_mhz, div64_u64(dev->rate_window_ticks * NSEC_PER_SEC * 1000, elapsed));
+        dev->rate_window_start = now;
+        dev->rate_window_ticks = 0;
+    }
+}
+
+// apply trace records until the next one is due later, timer context
+static enum hrtimer_restart play_trace(struct ihubx24_device *dev)
+{
+    u64 delay = 0;
+    int batch;
+    
+    for (batch = 0; batch < TRACE_BATCH && delay == 0; batch++) {
+        spin_lock(&dev->input_lock);
+        apply_input_states(dev, le32_to_cpu(dev->trace_records[dev->trace_pos].state) & INPUTS_MASK);
+        spin_unlock(&dev->input_lock);
+        update_rate(dev, ktime_get_ns());
+        
+        if (dev->trace_pos + 1 == dev->trace_count) {
+            if (!dev->trace_loop) {
+                WRITE_ONCE(dev->trace_pos, dev->trace_count);
+                dev->trace_playing = false;
+                dbg_dev_info(2, dev->device_id, "Trace %s finished\n", dev->trace_name);
+                return HRTIMER_NORESTART;
+            }
+            WRITE_ONCE(dev->trace_pos, 0);
+        } else {
+            WRITE_ONCE(dev->trace_pos, dev->trace_pos + 1);
+        }
+        
+        // paced by readers: reads restart the timer once all readers caught up
+        if (dev->trace_speed == 0) {
+            dev->trace_waiting = true;
+            return HRTIMER_NORESTART;
+        }
+        
+        delay = div_u64(le64_to_cpu(dev->trace_records[dev->trace_pos].delta_ns), dev->trace_speed);
+    }
+    
+    // schedule from the previous expiry so the replay does not drift, a long
+    // burst of simultaneous records yields the CPU for a microsecond
+    if (delay == 0) {
+        hrtimer_forward_now(&dev->input_timer, ns_to_ktime(NSEC_PER_USEC));
+    } else {
+        hrtimer_add_expires_ns(&dev->input_timer, delay);
+    }
+    return HRTIMER_RESTART;
+}
+
+static enum hrtimer_restart update_input_states(struct hrtimer *t)
+{
+    struct ihubx24_device *dev = container_of(t, struct ihubx24_device, input_timer);
+    enum hrtimer_restart restart;
+    u64 overruns;
+    u32 state;
+    
+    if (dev->trace_fw) {
+        restart = dev->trace_playing ? play_trace(dev) : HRTIMER_NORESTART;
+        if (trace_ihubx24_sim_timer_enabled()) {
+            trace_ihubx24_sim_timer(dev->device_id, input_states_mask(dev->input_states), 0);
+        }
+        return restart;
+    }
+    
+    // one draw gives the states of all inputs, if they changed the
+    // readers are woken up
+    state = prandom_u32_state(&dev->rng) & INPUTS_MASK;
+    spin_lock(&dev->input_lock);
+    apply_input_states(dev, state);
+    spin_unlock(&dev->input_lock);
+    
+    // Reschedule the timer, counting periods the callback could not keep up with
+    overruns = hrtimer_forward_now(t, ns_to_ktime(READ_ONCE(dev->period_ns)));
+    if (overruns > 1) {
+        WRITE_ONCE(dev->overruns, dev->overruns + overruns - 1);
+    }
+    update_rate(dev, ktime_get_ns());
+    trace_ihubx24_sim_timer(dev->device_id, state, overruns > 1 ? overruns - 1 : 0);
+    
+    // Only log state updates if verbose debugging is enabled
+    dbg_dev_info(3, dev->device_id, "Input states updated to %c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c\n",
+           dev->input_states[0], dev->input_states[1], dev->input_states[2], dev->input_states[3],
+           dev->input_states[4], dev->input_states[5], dev->input_states[6], dev->input_states[7],
+           dev->input_states[8], dev->input_states[9], dev->input_states[10], dev->input_states[11],
+           dev->input_states[12], dev->input_states[13], dev->input_states[14], dev->input_states[15],
+           dev->input_states[16], dev->input_states[17], dev->input_states[18], dev->input_states[19],
+           dev->input_states[20], dev->input_states[21], dev->input_states[22], dev->input_states[23]);
+    
+    return HRTIMER_RESTART;
+}
+
+static ssize_t period_us_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    if (!ihub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%llu\n", div_u64(READ_ONCE(ihub_dev->period_ns), NSEC_PER_USEC));
+}
+
+static ssize_t period_us_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    unsigned long long value;
+    int ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    ret = kstrtoull(buf, 10, &value);
+    if (ret) return ret;
+    if (value < MIN_PERIOD_US || value > MAX_PERIOD_US) return -EINVAL;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    WRITE_ONCE(ihub_dev->period_ns, value * NSEC_PER_USEC);
+    
+    // apply the new period immediately and start a fresh rate window,
+    // a loaded trace keeps the timer until it is unloaded
+    if (!ihub_dev->trace_fw) {
+        hrtimer_cancel(&ihub_dev->input_timer);
+        ihub_dev->rate_window_start = ktime_get_ns();
+        ihub_dev->rate_window_ticks = 0;
+        WRITE_ONCE(ihub_dev->rate_mhz, 0);
+        WRITE_ONCE(ihub_dev->overruns, 0);
+        hrtimer_start(&ihub_dev->input_timer, ns_to_ktime(ihub_dev->period_ns), HRTIMER_MODE_REL_SOFT);
+    }
+    mutex_unlock(&ihub_dev->timer_mutex);
+    
+    dbg_dev_info(2, ihub_dev->device_id, "Update period set to %llu us\n", value);
+    return count;
+}
+
+// achieved updates per second over the last window, and missed periods
+static ssize_t rate_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    u64 rate_mhz;
+    u32 rem;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    rate_mhz = div_u64_rem(READ_ONCE(ihub_dev->rate_mhz), 1000, &rem);
+    return sprintf(buf, "%llu.%03u updates/s, %llu overruns\n", rate_mhz, rem, READ_ONCE(ihub_dev->overruns));
+}
+
+static ssize_t seed_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    if (!ihub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%llu\n", ihub_dev->seed);
+}
+
+// restart the input sequence from a new seed, the period restarts as well
+static ssize_t seed_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    unsigned long long value;
+    int ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    ret = kstrtoull(buf, 10, &value);
+    if (ret) return ret;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    if (ihub_dev->trace_fw) {
+        mutex_unlock(&ihub_dev->timer_mutex);
+        return -EBUSY;
+    }
+    hrtimer_cancel(&ihub_dev->input_timer);
+    spin_lock_bh(&ihub_dev->input_lock);
+    seed_input_states(ihub_dev, value);
+    notify_readers(ihub_dev);
+    spin_unlock_bh(&ihub_dev->input_lock);
+    hrtimer_start(&ihub_dev->input_timer, ns_to_ktime(ihub_dev->period_ns), HRTIMER_MODE_REL_SOFT);
+    mutex_unlock(&ihub_dev->timer_mutex);
+    
+    dbg_dev_info(2, ihub_dev->device_id, "Input generator reseeded with %llu\n", value);
+    return count;
+}
+
+// caller holds timer_mutex and has cancelled input_timer
+static void trace_start(struct ihubx24_device *dev)
+{
+    u64 delay = 0;
+    
+    if (dev->trace_pos >= dev->trace_count) {
+        dev->trace_pos = 0;
+    }
+    if (dev->trace_speed > 0) {
+        delay = div_u64(le64_to_cpu(dev->trace_records[dev->trace_pos].delta_ns), dev->trace_speed);
+    }
+    dev->trace_playing = true;
+    dev->trace_waiting = false;
+    hrtimer_start(&dev->input_timer, ns_to_ktime(delay), HRTIMER_MODE_REL_SOFT);
+}
+
+// caller holds timer_mutex
+static void trace_unload(struct ihubx24_device *dev)
+{
+    hrtimer_cancel(&dev->input_timer);
+    release_firmware(dev->trace_fw);
+    dev->trace_fw = NULL;
+    dev->trace_records = NULL;
+    dev->trace_count = 0;
+    dev->trace_pos = 0;
+    dev->trace_playing = false;
+    dev->trace_waiting = false;
+    strscpy(dev->trace_name, "none", sizeof(dev->trace_name));
+}
+
+static bool readers_caught_up(struct ihubx24_device *dev)
+{
+    struct ihubx24_sim_reader *reader;
+    bool idle;
+    
+    spin_lock_bh(&dev->readers_lock);
+    idle = !list_empty(&dev->readers_list);
+    list_for_each_entry(reader, &dev->readers_list, list) {
+        if (reader_has_data(reader)) {
+            idle = false;
+            break;
+        }
+    }
+    spin_unlock_bh(&dev->readers_lock);
+    return idle;
+}
+
+// reader-paced replay: emit the next record once every reader consumed the last one
+static void trace_kick(struct ihubx24_device *dev)
+{
+    if (!READ_ONCE(dev->trace_waiting)) {
+        return;
+    }
+    
+    mutex_lock(&dev->timer_mutex);
+    if (dev->trace_waiting && dev->trace_playing && readers_caught_up(dev)) {
+        dev->trace_waiting = false;
+        hrtimer_start(&dev->input_timer, 0, HRTIMER_MODE_REL_SOFT);
+    }
+    mutex_unlock(&dev->timer_mutex);
+}
+
+static ssize_t trace_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    ssize_t ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    ret = sprintf(buf, "%s\n", ihub_dev->trace_name);
+    mutex_unlock(&ihub_dev->timer_mutex);
+    return ret;
+}
+
+// load a trace with request_firmware(), "none" returns to random inputs
+static ssize_t trace_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    const struct ihubx24_trace_header *header;
+    const struct firmware *fw;
+    char name[TRACE_NAME_SIZE];
+    u32 records;
+    int ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    if (strscpy(name, buf, sizeof(name)) < 0) return -EINVAL;
+    strim(name);
+    
+    if (name[0] == '\0' || strcmp(name, "none") == 0) {
+        mutex_lock(&ihub_dev->timer_mutex);
+        if (ihub_dev->trace_fw) {
+            trace_unload(ihub_dev);
+            hrtimer_start(&ihub_dev->input_timer, ns_to_ktime(ihub_dev->period_ns), HRTIMER_MODE_REL_SOFT);
+            dbg_dev_info(2, ihub_dev->device_id, "Trace unloaded, random inputs resumed\n");
+        }
+        mutex_unlock(&ihub_dev->timer_mutex);
+        return count;
+    }
+    
+    ret = request_firmware(&fw, name, dev);
+    if (ret) {
+        dbg_err("Failed to load trace %s (%d)\n", name, ret);
+        return ret;
+    }
+    
+    header = (const struct ihubx24_trace_header *)fw->data;
+    records = fw->size >= sizeof(*header) ? le32_to_cpu(header->count) : 0;
+    if (fw->size < sizeof(*header) || le32_to_cpu(header->magic) != IHUBX24_TRACE_MAGIC || records == 0 ||
+        (fw->size - sizeof(*header)) / sizeof(struct ihubx24_trace_record) != records ||
+        (fw->size - sizeof(*header)) % sizeof(struct ihubx24_trace_record) != 0) {
+        dbg_err("Invalid trace file %s\n", name);
+        release_firmware(fw);
+        return -EINVAL;
+    }
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    trace_unload(ihub_dev);
+    ihub_dev->trace_fw = fw;
+    ihub_dev->trace_records = (const struct ihubx24_trace_record *)(fw->data + sizeof(*header));
+    ihub_dev->trace_count = records;
+    strscpy(ihub_dev->trace_name, name, sizeof(ihub_dev->trace_name));
+    mutex_unlock(&ihub_dev->timer_mutex);
+    
+    dbg_dev_info(2, ihub_dev->device_id, "Trace %s loaded (%u records)\n", name, records);
+    return count;
+}
+
+static ssize_t trace_control_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    if (!ihub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%s\n", READ_ONCE(ihub_dev->trace_playing) ? "play" : "stop");
+}
+
+static ssize_t trace_control_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    int ret = count;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    if (!ihub_dev->trace_fw) {
+        ret = -ENOENT;
+    } else if (sysfs_streq(buf, "play")) {
+        hrtimer_cancel(&ihub_dev->input_timer);
+        trace_start(ihub_dev);
+    } else if (sysfs_streq(buf, "stop")) {
+        hrtimer_cancel(&ihub_dev->input_timer);
+        ihub_dev->trace_playing = false;
+        ihub_dev->trace_waiting = false;
+    } else {
+        ret = -EINVAL;
+    }
+    mutex_unlock(&ihub_dev->timer_mutex);
+    
+    return ret;
+}
+
+static ssize_t trace_speed_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    if (!ihub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%u\n", READ_ONCE(ihub_dev->trace_speed));
+}
+
+// N = replay at Nx, 0 = as fast as readers consume
+static ssize_t trace_speed_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    unsigned int value;
+    int ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    ret = kstrtouint(buf, 10, &value);
+    if (ret) return ret;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    hrtimer_cancel(&ihub_dev->input_timer);
+    ihub_dev->trace_speed = value;
+    if (ihub_dev->trace_playing) {
+        trace_start(ihub_dev);
+    } else if (!ihub_dev->trace_fw) {
+        hrtimer_start(&ihub_dev->input_timer, ns_to_ktime(ihub_dev->period_ns), HRTIMER_MODE_REL_SOFT);
+    }
+    mutex_unlock(&ihub_dev->timer_mutex);
+    
+    return count;
+}
+
+static ssize_t trace_loop_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    if (!ihub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%d\n", READ_ONCE(ihub_dev->trace_loop));
+}
+
+static ssize_t trace_loop_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    bool value;
+    int ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    ret = kstrtobool(buf, &value);
+    if (ret) return ret;
+    
+    WRITE_ONCE(ihub_dev->trace_loop, value);
+    return count;
+}
+
+static ssize_t trace_position_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    ssize_t ret;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    mutex_lock(&ihub_dev->timer_mutex);
+    ret = sprintf(buf, "%u/%u\n", READ_ONCE(ihub_dev->trace_pos), ihub_dev->trace_count);
+    mutex_unlock(&ihub_dev->timer_mutex);
+    return ret;
+}
+
+static const char *wire_source_name(u8 source)
+{
+    return source == DSIM_WIRE_OHUBX24 ? "ohubx24-sim" : "iohubx24-sim";
+}
+
+// one line per wired input: "<input> <source device>:<output>"
+static ssize_t wiring_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    const struct ihubx24_wire *wire;
+    ssize_t len = 0;
+    int i;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    spin_lock_bh(&wiring_lock);
+    for (i = 0; i < NUM_INPUTS; i++) {
+        wire = &ihub_dev->wires[i];
+        if (wire->source) {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%d %s%u:%u\n", i,
+                             wire_source_name(wire->source), wire->minor, wire->output);
+        }
+    }
+    spin_unlock_bh(&wiring_lock);
+    return len;
+}
+
+// "3 ohubx24-sim1:5" makes input 3 follow output 5 of ohubx24-sim1, iohubx24-simN
+// channels are wired the same way; "3 none" returns input 3 to the generator
+static ssize_t wiring_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ihubx24_device *ihub_dev = dev_get_drvdata(dev);
+    struct ihubx24_wire *wire;
+    unsigned int input, minor = 0, output = 0;
+    char word[5];
+    u8 source;
+    
+    if (!ihub_dev) return -ENODEV;
+    
+    if (sscanf(buf, "%u ohubx24-sim%u:%u", &input, &minor, &output) == 3) {
+        source = DSIM_WIRE_OHUBX24;
+    } else if (sscanf(buf, "%u iohubx24-sim%u:%u", &input, &minor, &output) == 3) {
+        source = DSIM_WIRE_IOHUBX24;
+    } else if (sscanf(buf, "%u %4s", &input, word) == 2 && strcmp(word, "none") == 0) {
+        source = 0;
+    } else {
+        return -EINVAL;
+    }
+    if (input >= NUM_INPUTS || minor >= MAX_DEVICES || output >= NUM_INPUTS) {
+        return -EINVAL;
+    }
+    
+    spin_lock_bh(&wiring_lock);
+    spin_lock(&ihub_dev->input_lock);
+    wire = &ihub_dev->wires[input];
+    wire->source = source;
+    wire->minor = minor;
+    wire->output = output;
+    if (source) {
+        // the input keeps its state until the source writes its outputs
+        if (ihub_dev->input_states[input] == '1') {
+            ihub_dev->wired_state |= BIT(input);
+        } else {
+            ihub_dev->wired_state &= ~BIT(input);
+        }
+        ihub_dev->wired_mask |= BIT(input);
+    } else {
+        ihub_dev->wired_mask &= ~BIT(input);
+    }
+    spin_unlock(&ihub_dev->input_lock);
+    
+    if (ihub_dev->wired_mask && list_empty(&ihub_dev->wired_list)) {
+        list_add_tail(&ihub_dev->wired_list, &wired_devices);
+    } else if (!ihub_dev->wired_mask) {
+        list_del_init(&ihub_dev->wired_list);
+    }
+    spin_unlock_bh(&wiring_lock);
+    
+    if (source) {
+        dbg_dev_info(2, ihub_dev->device_id, "Input %u wired to %s%u:%u\n", input,
+                     wire_source_name(source), minor, output);
+    } else {
+        dbg_dev_info(2, ihub_dev->device_id, "Input %u unwired\n", input);
+    }
+    return count;
+}
+
+// The wire hook of ohubx24-sim and iohubx24-sim, called with the new output
+// state of one of their devices. The inputs wired to it change in the
+// caller's context, so blocked readers are woken before the source's write()
+// returns.
+static void wire_outputs(int source, int minor, u32 state)
+{
+    struct ihubx24_device *dev;
+    const struct ihubx24_wire *wire;
+    u32 wired_state;
+    int i;
+    
+    // a wire added meanwhile takes the state of the next change
+    if (list_empty(&wired_devices)) {
+        return;
+    }
+    
+    spin_lock_bh(&wiring_lock);
+    list_for_each_entry(dev, &wired_devices, wired_list) {
+        wired_state = dev->wired_state;
+        for (i = 0; i < NUM_INPUTS; i++) {
+            wire = &dev->wires[i];
+            if (wire->source != source || wire->minor != minor) {
+                continue;
+            }
+            if (state & BIT(wire->output)) {
+                wired_state |= BIT(i);
+            } else {
+                wired_state &= ~BIT(i);
+            }
+        }
+        if (wired_state == dev->wired_state) {
+            continue;
+        }
+        
+        spin_lock(&dev->input_lock);
+        dev->wired_state = wired_state;
+        apply_input_states(dev, input_states_mask(dev->input_states));
+        spin_unlock(&dev->input_lock);
+    }
+    spin_unlock_bh(&wiring_lock);
+}
+
+// hand wire_outputs() to the source modules that are loaded, or take it back
+static void set_wire_hooks(dsim_wire_fn fn)
+{
+    void (*set_hook)(dsim_wire_fn);
+    
+    set_hook = dsim_symbol_get(ohubx24_sim_set_wire_hook);
+    if (set_hook) {
+        set_hook(fn);
+        dsim_symbol_put(ohubx24_sim_set_wire_hook);
+    }
+    set_hook = dsim_symbol_get(iohubx24_sim_set_wire_hook);
+    if (set_hook) {
+        set_hook(fn);
+        dsim_symbol_put(iohubx24_sim_set_wire_hook);
+    }
+}
+
+// a source loaded after ihubx24-sim gets the hook once its init is done
+static int wire_module_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+    struct module *mod = data;
+    
+    if (action == MODULE_STATE_LIVE &&
+        (strcmp(mod->name, "ohubx24_sim") == 0 || strcmp(mod->name, "iohubx24_sim") == 0)) {
+        set_wire_hooks(wire_outputs);
+    }
+    return NOTIFY_OK;
+}
+
+static struct notifier_block wire_module_nb = {
+    .notifier_call = wire_module_notify,
+};
+
+// current input states, for plc-sim
+int ihubx24_sim_get_inputs(int minor, u32 *state)
+{
+    struct ihubx24_device *dev;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        spin_lock_bh(&dev->input_lock);
+        *state = input_states_mask(dev->input_states);
+        spin_unlock_bh(&dev->input_lock);
+    }
+    mutex_unlock(&devices_mutex);
+    return dev ? 0 : -ENODEV;
+}
+EXPORT_SYMBOL_GPL(ihubx24_sim_get_inputs);
+
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct ihubx24_device *dev;
+    char device_name[32];
+    int ret;
+    
+    dev = kzalloc(sizeof(struct ihubx24_device), GFP_KERNEL);
+    if (!dev) {
+        return -ENOMEM;
+    }
+    
+    dev->stats = alloc_percpu(struct ihubx24_stats);
+    if (!dev->stats) {
+        kfree(dev);
+        return -ENOMEM;
+    }
+    
+    ret = idr_alloc(&devices_idr, dev, id, id + 1, GFP_KERNEL);
+    if (ret < 0) {
+        free_percpu(dev->stats);
+        kfree(dev);
+        return ret == -ENOSPC ? -EEXIST : ret;
+    }
+    
+    dev->device_id = id;
+    dsim_notifier_init(&dev->notify);
+    seqcount_init(&dev->change_seqcount);
+    INIT_LIST_HEAD(&dev->readers_list);
+    INIT_LIST_HEAD(&dev->queued_readers_list);
+    INIT_LIST_HEAD(&dev->masked_readers_list);
+    spin_lock_init(&dev->readers_lock);
+    spin_lock_init(&dev->input_lock);
+    INIT_LIST_HEAD(&dev->wired_list);
+    mutex_init(&dev->timer_mutex);
+    dev->trace_speed = 1;
+    strscpy(dev->trace_name, "none", sizeof(dev->trace_name));
+    
+    seed_input_states(dev, seed ? seed + id : get_random_u64());
+    // the initial states count as change 0 at creation time
+    dev->change_ns = ktime_get_ns();
+    dev->change_state = input_states_mask(dev->input_states);
+    
+    // setup the timer for updating input states, runs in softirq context
+    dev->period_ns = period_us * NSEC_PER_USEC;
+    dev->rate_window_start = ktime_get_ns();
+    HRTIMER_SETUP_COMPAT(&dev->input_timer, update_input_states, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+    
+    snprintf(device_name, sizeof(device_name), "%s%d", DEVICE_NAME, id);
+    
+    dev->device = device_create(ihubx24_sim_class, NULL, MKDEV(major_number, id), dev, device_name);
+    if (IS_ERR(dev->device)) {
+        dbg_err("Failed to create device %s\n", device_name);
+        ret = PTR_ERR(dev->device);
+        goto cleanup_dev;
+    }
+    
+    ret = sysfs_create_groups(&dev->device->kobj, ihubx24_attr_groups);
+    if (ret) {
+        dbg_err("Failed to create sysfs attributes for device %d\n", id);
+        device_destroy(ihubx24_sim_class, MKDEV(major_number, id));
+        goto cleanup_dev;
+    }
+    
+    hrtimer_start(&dev->input_timer, ns_to_ktime(dev->period_ns), HRTIMER_MODE_REL_SOFT);
+    
+    // a new device changes the snapshot of the aggregate file
+    dsim_fleet_publish(&fleet);
+    dsim_fleet_wake(&fleet);
+    
+    dbg_dev_info(1, id, "Device created correctly\n");
+    // Only show initial states if operations debugging is enabled
+    dbg_dev_info(2, id, "Initial input states: %.24s\n", dev->input_states);
+    return 0;
+    
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&dev->timer_mutex);
+    free_percpu(dev->stats);
+    kfree(dev);
+    return ret;
+}
+
+// caller holds devices_mutex, the device must not be open
+static void destroy_device(struct ihubx24_device *dev)
+{
+    int id = dev->device_id;
+    
+    sysfs_remove_groups(&dev->device->kobj, ihubx24_attr_groups);
+    device_destroy(ihubx24_sim_class, MKDEV(major_number, id));
+    spin_lock_bh(&wiring_lock);
+    list_del(&dev->wired_list);
+    spin_unlock_bh(&wiring_lock);
+    hrtimer_cancel(&dev->input_timer);
+    release_firmware(dev->trace_fw);
+    mutex_destroy(&dev->timer_mutex);
+    idr_remove(&devices_idr, id);
+    free_percpu(dev->stats);
+    kfree(dev);
+    dsim_fleet_publish(&fleet);
+    dsim_fleet_wake(&fleet);
+    
+    dbg_dev_info(1, id, "Device removed\n");
+}
+
+static void destroy_all_devices(void)
+{
+    struct ihubx24_device *dev;
+    int id;
+    
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, dev, id) {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// look up a device by minor and keep it from being deleted until ihubx24_put()
+static struct ihubx24_device *ihubx24_get(int minor)
+{
+    struct ihubx24_device *dev;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        dev->open_count++;
+    }
+    mutex_unlock(&devices_mutex);
+    return dev;
+}
+
+static void ihubx24_put(struct ihubx24_device *dev)
+{
+    mutex_lock(&devices_mutex);
+    dev->open_count--;
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/ihubx24/new_device creates /dev/ihubx24-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+    
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+// echo N > /sys/class/ihubx24/delete_device removes /dev/ihubx24-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct ihubx24_device *dev;
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, id);
+    if (!dev) {
+        ret = -ENODEV;
+    } else if (dev->open_count) {
+        ret = -EBUSY;
+    } else {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
+static int __init ihubx24_sim_init(void) {
+    int i;
+    int ret = 0;
+    
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
+        dbg_err("Invalid num_devices (%d). Must be 0-%d\n", num_devices, MAX_DEVICES);
+        return -EINVAL;
+    }
+    
+    if (period_us < MIN_PERIOD_US || period_us > MAX_PERIOD_US) {
+        dbg_err("Invalid period_us (%llu). Must be %llu-%llu\n", period_us, MIN_PERIOD_US, MAX_PERIOD_US);
+        return -EINVAL;
+    }
+    
+    dbg_info(1, "Initializing %d ihubx24-sim device(s)\n", num_devices);
+    
+    dsim_fleet_init(&fleet);
+
+    major_number = __register_chrdev(0, 0, MAX_DEVICES, DEVICE_NAME, &fops);
+    if (major_number < 0) {
+        dbg_err("Failed to register a major number\n");
+        return major_number;
+    }
+    dbg_info(1, "Registered correctly with major number %d\n", major_number);
+
+    ihubx24_sim_class = CLASS_CREATE_COMPAT(CLASS_NAME);
+    if (IS_ERR(ihubx24_sim_class)) {
+        __unregister_chrdev(major_number, 0, MAX_DEVICES, DEVICE_NAME);
+        dbg_err("Failed to register device class\n");
+        return PTR_ERR(ihubx24_sim_class);
+    }
+    dbg_info(1, "Device class registered correctly\n");
+
+    reader_cache = KMEM_CACHE(ihubx24_sim_reader, 0);
+    if (!reader_cache) {
+        ret = -ENOMEM;
+        goto cleanup_devices;
+    }
+
+    event_bus = dsim_events_register("ihubx24_sim", DSIM_EVENTS_IHUBX24);
+    if (IS_ERR(event_bus)) {
+        ret = PTR_ERR(event_bus);
+        dbg_err("Failed to register the events family\n");
+        goto cleanup_devices;
+    }
+
+    // create the initial devices, more can be added through new_device
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices; i++) {
+        ret = create_device(i);
+        if (ret) {
+            break;
+        }
+    }
+    mutex_unlock(&devices_mutex);
+    if (ret) {
+        goto cleanup_devices;
+    }
+    
+    // /dev/ihubx24-sim-all, a snapshot of all the devices
+    ret = __register_chrdev(major_number, ALL_MINOR, 1, DEVICE_NAME "-all", &all_fops);
+    if (ret < 0) {
+        goto cleanup_devices;
+    }
+    all_device = device_create(ihubx24_sim_class, NULL, MKDEV(major_number, ALL_MINOR), NULL, DEVICE_NAME "-all");
+    if (IS_ERR(all_device)) {
+        dbg_err("Failed to create the aggregate device\n");
+        ret = PTR_ERR(all_device);
+        __unregister_chrdev(major_number, ALL_MINOR, 1, DEVICE_NAME "-all");
+        goto cleanup_devices;
+    }
+    
+    ret = class_create_file(ihubx24_sim_class, &class_attr_new_device);
+    if (ret) {
+        goto cleanup_all;
+    }
+    ret = class_create_file(ihubx24_sim_class, &class_attr_delete_device);
+    if (ret) {
+        class_remove_file(ihubx24_sim_class, &class_attr_new_device);
+        goto cleanup_all;
+    }
+    
+    ret = register_module_notifier(&wire_module_nb);
+    if (ret) {
+        class_remove_file(ihubx24_sim_class, &class_attr_delete_device);
+        class_remove_file(ihubx24_sim_class, &class_attr_new_device);
+        goto cleanup_all;
+    }
+    set_wire_hooks(wire_outputs);
+           
+    return 0;
+
+cleanup_all:
+    device_destroy(ihubx24_sim_class, MKDEV(major_number, ALL_MINOR));
+    __unregister_chrdev(major_number, ALL_MINOR, 1, DEVICE_NAME "-all");
+cleanup_devices:
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    kmem_cache_destroy(reader_cache);
+    class_destroy(ihubx24_sim_class);
+    __unregister_chrdev(major_number, 0, MAX_DEVICES, DEVICE_NAME);
+    return ret;
+}
+
+static void __dsim_exit ihubx24_sim_exit(void) {
+    // no source calls into the module once the hooks are cleared
+    unregister_module_notifier(&wire_module_nb);
+    set_wire_hooks(NULL);
+    synchronize_rcu();
+    
+    class_remove_file(ihubx24_sim_class, &class_attr_delete_device);
+    class_remove_file(ihubx24_sim_class, &class_attr_new_device);
+    device_destroy(ihubx24_sim_class, MKDEV(major_number, ALL_MINOR));
+    __unregister_chrdev(major_number, ALL_MINOR, 1, DEVICE_NAME "-all");
+    
+    // no file can be open here, the module is pinned while one is
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    kmem_cache_destroy(reader_cache);
+    
+    class_unregister(ihubx24_sim_class);
+    class_destroy(ihubx24_sim_class);
+    __unregister_chrdev(major_number, 0, MAX_DEVICES, DEVICE_NAME);
+    dbg_info(1, "Driver unloaded\n");
+}
+
+static int dev_open(struct inode *inodep, struct file *filep) {
+    struct ihubx24_sim_reader *reader;
+    struct ihubx24_device *dev;
+    int minor = iminor(inodep);
+    
+    dev = ihubx24_get(minor);
+    if (!dev) {
+        dbg_err("Invalid minor number %d\n", minor);
+        return -ENODEV;
+    }
+    
+    reader = kmem_cache_zalloc(reader_cache, GFP_KERNEL);
+    if (!reader) {
+        ihubx24_put(dev);
+        return -ENOMEM;
+    }
+    
+    if (queue_size > 0) {
+        if (kfifo_alloc(&reader->events, queue_size, GFP_KERNEL)) {
+            kmem_cache_free(reader_cache, reader);
+            ihubx24_put(dev);
+            return -ENOMEM;
+        }
+    }
+    
+    mutex_init(&reader->read_mutex);
+    reader->device = dev;
+    // the first read returns the current state
+    reader->seen_generation = dsim_generation(&dev->notify) - 1;
+    reader->read_mode = IHUBX24_READ_TEXT;
+    reader->mask = INPUTS_MASK;
+    init_waitqueue_head(&reader->wait);
+    
+    spin_lock_bh(&dev->readers_lock);
+    // queued readers start with the current state as their first event
+    if (reader_queued(reader)) {
+        reader_queue_event(reader, ktime_get_ns(), input_states_mask(dev->input_states));
+        list_add(&reader->queued_list, &dev->queued_readers_list);
+    }
+    list_add(&reader->list, &dev->readers_list);
+    spin_unlock_bh(&dev->readers_lock);
+    
+    filep->private_data = reader;
+    trace_kick(dev);
+    
+    trace_ihubx24_sim_open(minor, reader_queued(reader));
+    dbg_dev_info(2, minor, "Device opened\n");
+    return 0;
+}
+
+static int dev_release(struct inode *inodep, struct file *filep) {
+    struct ihubx24_sim_reader *reader = filep->private_data;
+    int minor = iminor(inodep);
+    
+    if (reader && reader->device) {
+        struct ihubx24_device *dev = reader->device;
+        
+        trace_ihubx24_sim_release(minor, reader_queued(reader));
+        
+        spin_lock_bh(&dev->readers_lock);
+        list_del(&reader->list);
+        if (reader_queued(reader)) {
+            list_del(&reader->queued_list);
+        }
+        if (reader->masked) {
+            list_del(&reader->masked_list);
+        }
+        spin_unlock_bh(&dev->readers_lock);
+        if (reader_queued(reader)) {
+            kfifo_free(&reader->events);
+        }
+        mutex_destroy(&reader->read_mutex);
+        kmem_cache_free(reader_cache, reader);
+        ihubx24_put(dev);
+    }
+    
+    dbg_dev_info(2, minor, "Device closed\n");
+    return 0;
+}
+
+static ssize_t dev_read_queued(struct ihubx24_sim_reader *reader, struct kiocb *iocb, struct iov_iter *to)
+{
+    struct ihubx24_event events[16];
+    size_t count = 0;
+    unsigned int n;
+    u32 state = 0;
+    
+    if (iov_iter_count(to) < sizeof(struct ihubx24_event)) {
+        return -EINVAL;
+    }
+    
+    if (kfifo_is_empty(&reader->events)) {
+        if ((iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+            this_cpu_inc(reader->device->stats->eagain);
+            return -EAGAIN;
+        }
+        if (wait_event_interruptible(reader->device->notify.wait, !kfifo_is_empty(&reader->events))) {
+            return -ERESTARTSYS;
+        }
+        trace_ihubx24_sim_wakeup(reader->device->device_id, dsim_generation(&reader->device->notify));
+    }
+    
+    // drain as many whole events as fit in the user buffer, an event is only
+    // removed from the queue once it was copied
+    mutex_lock(&reader->read_mutex);
+    while (iov_iter_count(to) >= sizeof(struct ihubx24_event)) {
+        n = min_t(size_t, ARRAY_SIZE(events), iov_iter_count(to) / sizeof(struct ihubx24_event));
+        n = kfifo_out_peek(&reader->events, events, n);
+        if (n == 0) {
+            break;
+        }
+        if (copy_to_iter(events, n * sizeof(struct ihubx24_event), to) != n * sizeof(struct ihubx24_event)) {
+            break;
+        }
+        n = kfifo_out(&reader->events, events, n);
+        state = events[n - 1].state;
+        count += n;
+    }
+    mutex_unlock(&reader->read_mutex);
+    
+    if (count == 0) {
+        dbg_dev_info(2, reader->device->device_id, "Failed to send events to the user\n");
+        return -EFAULT;
+    }
+    
+    trace_kick(reader->device);
+    
+    this_cpu_inc(reader->device->stats->reads);
+    this_cpu_add(reader->device->stats->bytes_out, count * sizeof(struct ihubx24_event));
+    trace_ihubx24_sim_read(reader->device->device_id, state, count * sizeof(struct ihubx24_event));
+    dbg_dev_info(3, reader->device->device_id, "Sent %zu event(s) to user\n", count);
+    return count * sizeof(struct ihubx24_event);
+}
+
+// consistent snapshot of the last change, the generation is caught up with
+// it once it was read
+static void read_change(struct ihubx24_sim_reader *reader, struct ihubx24_record *record)
+{
+    struct ihubx24_device *dev = reader->device;
+    unsigned int seq;
+    
+    do {
+        seq = read_seqcount_begin(&dev->change_seqcount);
+        record->timestamp_ns = dev->change_ns;
+        record->seq = dev->change_seq;
+        record->state = dev->change_state;
+    } while (read_seqcount_retry(&dev->change_seqcount, seq));
+    record->reserved = 0;
+    
+    WRITE_ONCE(reader->seen_generation, record->seq);
+}
+
+// one state per frame: the first read waits for a change, the buffer is then
+// filled with changes that are already pending
+static ssize_t dev_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    union {
+        char message[BUFFER_SIZE];
+        struct ihubx24_record record;
+    } frame;
+    struct ihubx24_sim_reader *reader = iocb->ki_filp->private_data;
+    wait_queue_head_t *wq;
+    size_t frame_size;
+    bool binary;
+    ssize_t total = 0;
+    
+    if (!reader || !reader->device) {
+        return -EFAULT;
+    }
+    
+    if (reader_queued(reader)) {
+        return dev_read_queued(reader, iocb, to);
+    }
+    
+    binary = READ_ONCE(reader->read_mode) == IHUBX24_READ_RECORD;
+    frame_size = binary ? sizeof(frame.record) : BUFFER_SIZE;
+    if (iov_iter_count(to) < frame_size) {
+        return -EINVAL;
+    }
+
+    // Wait for state change if needed (for blocking reads)
+    if (!reader_has_data(reader)) {
+        if ((iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+            this_cpu_inc(reader->device->stats->eagain);
+            return -EAGAIN;
+        }
+        // the queue is chosen once, a mask set meanwhile wakes both
+        wq = reader_wait(reader);
+        if (wait_event_interruptible(*wq, reader_has_data(reader))) {
+            return -ERESTARTSYS;
+        }
+        trace_ihubx24_sim_wakeup(reader->device->device_id, dsim_generation(&reader->device->notify));
+    }
+    
+    while (iov_iter_count(to) >= frame_size && reader_has_data(reader)) {
+        u64 seen = reader->seen_generation;
+        
+        if (binary) {
+            read_change(reader, &frame.record);
+        } else {
+            // a change racing with the copy bumps the generation again, so it
+            // is reported by the next frame
+            WRITE_ONCE(reader->seen_generation, dsim_generation(&reader->device->notify));
+            smp_rmb();
+            
+            memcpy(frame.message, reader->device->input_states, NUM_INPUTS);
+            frame.message[NUM_INPUTS] = '\n';  // Add newline
+        }
+        
+        if (copy_to_iter(&frame, frame_size, to) != frame_size) {
+            dbg_dev_info(2, reader->device->device_id, "Failed to send input states to the user\n");
+            if (total == 0) {
+                return -EFAULT;
+            }
+            break;
+        }
+        total += frame_size;
+        // a masked reader skips the changes filtered out by its mask, the
+        // ones it missed are counted by notify_readers()
+        if (!READ_ONCE(reader->masked) && reader->seen_generation - seen > 1) {
+            this_cpu_add(reader->device->stats->conflated, reader->seen_generation - seen - 1);
+        }
+    }
+    
+    this_cpu_inc(reader->device->stats->reads);
+    this_cpu_add(reader->device->stats->bytes_out, total);
+    trace_kick(reader->device);
+    
+    if (trace_ihubx24_sim_read_enabled()) {
+        trace_ihubx24_sim_read(reader->device->device_id,
+                               binary ? frame.record.state : input_states_mask(frame.message), total);
+    }
+    
+    // log successful reads if verbose debugging is enabled
+    dbg_dev_info(3, reader->device->device_id, "Sent input states to user\n");
+    return total;
+}
+
+static unsigned int dev_poll(struct file *filep, struct poll_table_struct *wait) {
+    unsigned int mask = 0;
+    struct ihubx24_sim_reader *reader = filep->private_data;
+    
+    if (!reader || !reader->device) {
+        return POLLERR;
+    }
+    
+    // a masked reader is only woken on its own waitqueue, which is polled
+    // in any case so that a mask set after the file was added to epoll
+    // still reports the changes
+    poll_wait(filep, &reader->wait, wait);
+    if (!READ_ONCE(reader->masked)) {
+        poll_wait(filep, &reader->device->notify.wait, wait);
+    }
+    
+    if (reader_has_data(reader)) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    
+    return mask;
+}
+
+static int all_open(struct inode *inodep, struct file *filep)
+{
+    struct ihubx24_sim_reader *reader;
+    
+    reader = kmem_cache_zalloc(reader_cache, GFP_KERNEL);
+    if (!reader) {
+        return -ENOMEM;
+    }
+    
+    atomic_inc(&fleet.readers);
+    // the first read returns the current states
+    reader->seen_generation = dsim_generation(&fleet.notify) - 1;
+    
+    filep->private_data = reader;
+    dbg_info(2, "Aggregate file opened\n");
+    return 0;
+}
+
+static int all_release(struct inode *inodep, struct file *filep)
+{
+    kmem_cache_free(reader_cache, filep->private_data);
+    atomic_dec(&fleet.readers);
+    dbg_info(2, "Aggregate file closed\n");
+    return 0;
+}
+
+// state and number of the last change of a device, like read_change()
+static void read_snapshot(struct ihubx24_device *dev, struct ihubx24_snapshot *entry)
+{
+    unsigned int seq;
+    
+    do {
+        seq = read_seqcount_begin(&dev->change_seqcount);
+        entry->seq = dev->change_seq;
+        entry->state = dev->change_state;
+    } while (read_seqcount_retry(&dev->change_seqcount, seq));
+    entry->minor = dev->device_id;
+}
+
+// one struct ihubx24_snapshot per device in minor order, as many as fit in
+// the buffer; waits for a change since the last read like the device files
+static ssize_t all_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct file *filep = iocb->ki_filp;
+    struct ihubx24_sim_reader *reader = filep->private_data;
+    struct ihubx24_snapshot *entries;
+    struct ihubx24_device *dev;
+    size_t max_entries = min_t(size_t, iov_iter_count(to) / sizeof(*entries), MAX_DEVICES);
+    size_t n = 0, size;
+    u64 generation = 0;
+    int id, pass;
+    
+    if (max_entries == 0) {
+        return -EINVAL;
+    }
+    
+    if (!dsim_pending(&fleet.notify, reader->seen_generation)) {
+        if ((filep->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+            return -EAGAIN;
+        }
+        if (wait_event_interruptible(fleet.notify.wait, dsim_pending(&fleet.notify, reader->seen_generation))) {
+            return -ERESTARTSYS;
+        }
+    }
+    
+    entries = kvmalloc_array(max_entries, sizeof(*entries), GFP_KERNEL);
+    if (!entries) {
+        return -ENOMEM;
+    }
+    
+    // devices_mutex keeps the table still, the pass is repeated while a
+    // device published a change during it so that the entries are of one
+    // instant; past SNAPSHOT_PASSES the last pass is returned and the
+    // reader stays pending
+    mutex_lock(&devices_mutex);
+    for (pass = 0; pass < SNAPSHOT_PASSES; pass++) {
+        generation = dsim_generation(&fleet.notify);
+        n = 0;
+        idr_for_each_entry(&devices_idr, dev, id) {
+            if (n == max_entries) {
+                break;
+            }
+            read_snapshot(dev, &entries[n++]);
+        }
+        smp_rmb();
+        if (dsim_generation(&fleet.notify) == generation) {
+            break;
+        }
+    }
+    mutex_unlock(&devices_mutex);
+    WRITE_ONCE(reader->seen_generation, generation);
+    
+    size = n * sizeof(*entries);
+    if (copy_to_iter(entries, size, to) != size) {
+        kvfree(entries);
+        return -EFAULT;
+    }
+    kvfree(entries);
+    
+    dbg_info(3, "Snapshot of %zu device(s) in %d pass(es)\n", n, pass + 1);
+    return size;
+}
+
+static unsigned int all_poll(struct file *filep, struct poll_table_struct *wait)
+{
+    struct ihubx24_sim_reader *reader = filep->private_data;
+    
+    poll_wait(filep, &fleet.notify.wait, wait);
+    
+    if (dsim_pending(&fleet.notify, READ_ONCE(reader->seen_generation))) {
+        return POLLIN | POLLRDNORM;
+    }
+    return 0;
+}
+
+// the reader moves to the masked list for good, a mask of all inputs only
+// brings back the wakeup on every change; the next read returns the
+// current state, and a read sleeping on the device waitqueue returns it
+static int reader_set_mask(struct ihubx24_sim_reader *reader, unsigned long mask)
+{
+    struct ihubx24_device *dev = reader->device;
+    u64 generation;
+    
+    if (mask == 0 || (mask & ~INPUTS_MASK)) {
+        return -EINVAL;
+    }
+    if (reader_queued(reader)) {
+        return -EBUSY;
+    }
+    
+    spin_lock_bh(&dev->readers_lock);
+    reader->mask = mask;
+    generation = dsim_generation(&dev->notify);
+    WRITE_ONCE(reader->wanted_generation, generation);
+    WRITE_ONCE(reader->seen_generation, generation - 1);
+    if (!reader->masked) {
+        list_add(&reader->masked_list, &dev->masked_readers_list);
+        WRITE_ONCE(reader->masked, true);
+    }
+    spin_unlock_bh(&dev->readers_lock);
+    
+    wake_up_interruptible(&reader->wait);
+    wake_up_interruptible(&dev->notify.wait);
+    
+    dbg_dev_info(2, dev->device_id, "Input mask set to %06lx\n", mask);
+    return 0;
+}
+
+// latest state readers choose between text and binary records, queued
+// readers already get timestamped events
+static long dev_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
+{
+    struct ihubx24_sim_reader *reader = filep->private_data;
+    
+    if (!reader || !reader->device) {
+        return -EFAULT;
+    }
+    
+    switch (cmd) {
+    case IHUBX24_IOC_SET_READ_MODE:
+        if (arg != IHUBX24_READ_TEXT && arg != IHUBX24_READ_RECORD) {
+            return -EINVAL;
+        }
+        if (reader_queued(reader)) {
+            return -EBUSY;
+        }
+        WRITE_ONCE(reader->read_mode, arg);
+        dbg_dev_info(2, reader->device->device_id, "Read mode set to %lu\n", arg);
+        return 0;
+    case IHUBX24_IOC_SET_MASK:
+        return reader_set_mask(reader, arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+DSIM_MODULE(ihub, ihubx24_sim_init, ihubx24_sim_exit)
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("DOMIoT");
+MODULE_DESCRIPTION("Input Hub x24 digital input channels module for simulation.");
+MODULE_VERSION("1.0.0");
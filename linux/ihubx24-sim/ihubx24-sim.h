@@ -0,0 +1,58 @@
+#ifndef _IHUBX24_SIM_H
+#define _IHUBX24_SIM_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define IHUBX24_NUM_INPUTS 24
+
+// record returned by read() when the module is loaded with queue_size > 0
+struct ihubx24_event {
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC time of the change
+    __u32 state;            // bit n = input channel n
+    __u32 dropped;          // events lost to queue overflow before this one
+};
+
+// record returned by read() in IHUBX24_READ_RECORD mode
+struct ihubx24_record {
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC time of the change
+    __u64 seq;              // change number, a gap means changes were missed
+    __u32 state;            // bit n = input channel n
+    __u32 reserved;
+};
+
+// entry returned by read() on /dev/ihubx24-sim-all, one per device in
+// minor order
+struct ihubx24_snapshot {
+    __u32 minor;
+    __u32 state;            // bit n = input channel n
+    __u64 seq;              // change number of the device, as in struct ihubx24_record
+};
+
+// read modes of latest state readers, selected per open file with
+// IHUBX24_IOC_SET_READ_MODE; queued readers always read struct ihubx24_event
+#define IHUBX24_READ_TEXT   0   // 24 digits and a newline (default)
+#define IHUBX24_READ_RECORD 1   // struct ihubx24_record
+
+#define IHUBX24_IOC_MAGIC 'i'
+
+// the mode is passed by value
+#define IHUBX24_IOC_SET_READ_MODE _IO(IHUBX24_IOC_MAGIC, 1)
+// the inputs a latest state reader is woken for, bit n = input channel n,
+// passed by value; the default is all of them
+#define IHUBX24_IOC_SET_MASK _IO(IHUBX24_IOC_MAGIC, 2)
+
+// trace file replayed by ihubx24-sim: a header followed by count records
+#define IHUBX24_TRACE_MAGIC 0x34324849  // "IH24"
+
+struct ihubx24_trace_header {
+    __le32 magic;
+    __le32 count;
+};
+
+struct ihubx24_trace_record {
+    __le64 delta_ns;        // delay since the previous record
+    __le32 state;           // bit n = input channel n
+} __attribute__((packed));
+
+#endif
@@ -0,0 +1,102 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ihubx24_sim
+
+#if !defined(_IHUBX24_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _IHUBX24_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(ihubx24_sim_file,
+    TP_PROTO(int minor, bool queued),
+    TP_ARGS(minor, queued),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(bool, queued)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->queued = queued;
+    ),
+    TP_printk("minor=%d queued=%d", __entry->minor, __entry->queued)
+);
+
+DEFINE_EVENT(ihubx24_sim_file, ihubx24_sim_open,
+    TP_PROTO(int minor, bool queued),
+    TP_ARGS(minor, queued)
+);
+
+DEFINE_EVENT(ihubx24_sim_file, ihubx24_sim_release,
+    TP_PROTO(int minor, bool queued),
+    TP_ARGS(minor, queued)
+);
+
+// state is the last state returned, bytes the length of the read
+TRACE_EVENT(ihubx24_sim_read,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, state)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d state=%06x bytes=%zu", __entry->minor, __entry->state, __entry->bytes)
+);
+
+TRACE_EVENT(ihubx24_sim_state_change,
+    TP_PROTO(int minor, u32 state, u64 seq),
+    TP_ARGS(minor, state, seq),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, state)
+        __field(u64, seq)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->seq = seq;
+    ),
+    TP_printk("minor=%d state=%06x seq=%llu", __entry->minor, __entry->state, __entry->seq)
+);
+
+// a blocked reader returned from its wait
+TRACE_EVENT(ihubx24_sim_wakeup,
+    TP_PROTO(int minor, u64 generation),
+    TP_ARGS(minor, generation),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u64, generation)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->generation = generation;
+    ),
+    TP_printk("minor=%d generation=%llu", __entry->minor, __entry->generation)
+);
+
+TRACE_EVENT(ihubx24_sim_timer,
+    TP_PROTO(int minor, u32 state, u64 overruns),
+    TP_ARGS(minor, state, overruns),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, state)
+        __field(u64, overruns)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->overruns = overruns;
+    ),
+    TP_printk("minor=%d state=%06x overruns=%llu", __entry->minor, __entry->state, __entry->overruns)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
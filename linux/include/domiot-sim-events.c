@@ -0,0 +1,444 @@
+// State change events over generic netlink, see domiot-sim-events.h. Each
+// module links this file and registers its own family; domiot-sim.ko links
+// it once for all the simulators it bundles.
+
+#include <linux/version.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/err.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/netlink.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <net/genetlink.h>
+
+#include "domiot-sim-events.h"
+
+#define DSIM_EVENTS_BATCH 256
+#define DSIM_EVENTS_MAX_LISTENERS 64
+
+struct dsim_events_listener {
+    struct list_head list;
+    u32 portid;
+    u32 minor_first;
+    u32 minor_last;
+};
+
+struct dsim_events {
+    struct genl_family family;
+    // on dsim_events_list, to find the bus of a request or a socket
+    struct list_head list;
+    u16 module;
+    // registered, buf and the counters, taken from the state change paths;
+    // the work is only queued under the lock while registered is set
+    spinlock_t lock;
+    bool registered;
+    struct dsim_event buf[DSIM_EVENTS_BATCH];
+    unsigned int count;
+    u32 dropped;
+    // the batch being sent and the listeners it goes to, only touched by
+    // the work
+    struct dsim_event flush_buf[DSIM_EVENTS_BATCH];
+    struct dsim_events_listener flush_listeners[DSIM_EVENTS_MAX_LISTENERS];
+    struct work_struct work;
+    // sockets subscribed to a range of minors, the lock is not held while
+    // sending so that a closing socket can always drop its entry
+    spinlock_t listeners_lock;
+    struct list_head listeners;
+    unsigned int num_listeners;
+};
+
+// the registered buses, one per module or one per simulator in domiot-sim.ko;
+// the list is changed under both, dsim_events_mutex also covers the notifier
+static LIST_HEAD(dsim_events_list);
+static DEFINE_SPINLOCK(dsim_events_list_lock);
+static DEFINE_MUTEX(dsim_events_mutex);
+
+void dsim_event(struct dsim_events *ev, u16 minor, u64 seq, u64 timestamp_ns, u32 state)
+{
+    unsigned long flags;
+
+    if (!READ_ONCE(ev->num_listeners) && !genl_has_listeners(&ev->family, &init_net, 0)) {
+        return;
+    }
+
+    spin_lock_irqsave(&ev->lock, flags);
+    if (!ev->registered) {
+        spin_unlock_irqrestore(&ev->lock, flags);
+        return;
+    }
+    if (ev->count < DSIM_EVENTS_BATCH) {
+        struct dsim_event *e = &ev->buf[ev->count++];
+
+        e->timestamp_ns = timestamp_ns;
+        e->seq = seq;
+        e->state = state;
+        e->module = ev->module;
+        e->minor = minor;
+    } else {
+        ev->dropped++;
+    }
+    schedule_work(&ev->work);
+    spin_unlock_irqrestore(&ev->lock, flags);
+}
+
+static struct sk_buff *dsim_events_msg(struct dsim_events *ev, u32 portid,
+                                       const struct dsim_event *events, unsigned int count, u32 dropped)
+{
+    struct sk_buff *skb;
+    struct nlattr *attr;
+    void *hdr;
+
+    skb = genlmsg_new(nla_total_size(count * sizeof(*events)) + nla_total_size(sizeof(u32)), GFP_KERNEL);
+    if (!skb) {
+        return NULL;
+    }
+    hdr = genlmsg_put(skb, portid, 0, &ev->family, 0, DSIM_EVENTS_CMD_EVENTS);
+    if (!hdr) {
+        goto fail;
+    }
+    attr = nla_reserve(skb, DSIM_EVENTS_A_EVENTS, count * sizeof(*events));
+    if (!attr) {
+        goto fail;
+    }
+    memcpy(nla_data(attr), events, count * sizeof(*events));
+    if (dropped && nla_put_u32(skb, DSIM_EVENTS_A_DROPPED, dropped)) {
+        goto fail;
+    }
+    genlmsg_end(skb, hdr);
+    return skb;
+
+fail:
+    nlmsg_free(skb);
+    return NULL;
+}
+
+// forget the subscription of a socket, if it has one
+static void dsim_events_drop(struct dsim_events *ev, u32 portid)
+{
+    struct dsim_events_listener *listener;
+
+    spin_lock(&ev->listeners_lock);
+    list_for_each_entry(listener, &ev->listeners, list) {
+        if (listener->portid == portid) {
+            list_del(&listener->list);
+            kfree(listener);
+            WRITE_ONCE(ev->num_listeners, ev->num_listeners - 1);
+            break;
+        }
+    }
+    spin_unlock(&ev->listeners_lock);
+}
+
+// send the events of the listener's minors, they are contiguous in a
+// copy of the batch so one message carries all of them
+static void dsim_events_unicast(struct dsim_events *ev, const struct dsim_events_listener *listener,
+                                unsigned int count, u32 dropped, struct dsim_event *filtered)
+{
+    struct sk_buff *skb;
+    unsigned int i, n = 0;
+
+    for (i = 0; i < count; i++) {
+        const struct dsim_event *e = &ev->flush_buf[i];
+
+        if (e->minor >= listener->minor_first && e->minor <= listener->minor_last) {
+            filtered[n++] = *e;
+        }
+    }
+    if (!n && !dropped) {
+        return;
+    }
+
+    skb = dsim_events_msg(ev, 0, filtered, n, dropped);
+    if (!skb) {
+        return;
+    }
+    // the socket is gone without a NETLINK_URELEASE reaching us
+    if (genlmsg_unicast(&init_net, skb, listener->portid) == -ECONNREFUSED) {
+        dsim_events_drop(ev, listener->portid);
+    }
+}
+
+static void dsim_events_flush(struct work_struct *work)
+{
+    struct dsim_events *ev = container_of(work, struct dsim_events, work);
+    struct dsim_events_listener *listener;
+    struct dsim_event *filtered;
+    struct sk_buff *skb;
+    unsigned int count, i, n = 0;
+    u32 dropped;
+
+    spin_lock_irq(&ev->lock);
+    count = ev->count;
+    dropped = ev->dropped;
+    memcpy(ev->flush_buf, ev->buf, count * sizeof(*ev->buf));
+    ev->count = 0;
+    ev->dropped = 0;
+    spin_unlock_irq(&ev->lock);
+
+    if (!count && !dropped) {
+        return;
+    }
+
+    if (genl_has_listeners(&ev->family, &init_net, 0)) {
+        skb = dsim_events_msg(ev, 0, ev->flush_buf, count, dropped);
+        if (skb) {
+            genlmsg_multicast(&ev->family, skb, 0, 0, GFP_KERNEL);
+        }
+    }
+
+    spin_lock(&ev->listeners_lock);
+    list_for_each_entry(listener, &ev->listeners, list) {
+        ev->flush_listeners[n++] = *listener;
+    }
+    spin_unlock(&ev->listeners_lock);
+    if (!n) {
+        return;
+    }
+
+    filtered = kmalloc_array(count ? count : 1, sizeof(*filtered), GFP_KERNEL);
+    if (filtered) {
+        for (i = 0; i < n; i++) {
+            dsim_events_unicast(ev, &ev->flush_listeners[i], count, dropped, filtered);
+        }
+        kfree(filtered);
+    }
+}
+
+// the bus whose family a request was sent to, the families share their ops;
+// the caller holds dsim_events_list_lock
+static struct dsim_events *dsim_events_find(const struct genl_info *info)
+{
+    struct dsim_events *ev;
+
+    list_for_each_entry(ev, &dsim_events_list, list) {
+        if (ev->family.id == info->nlhdr->nlmsg_type) {
+            return ev;
+        }
+    }
+    return NULL;
+}
+
+static int dsim_events_subscribe(struct sk_buff *skb, struct genl_info *info)
+{
+    struct dsim_events *ev;
+    struct dsim_events_listener *listener, *new;
+    u32 minor_first = 0;
+    u32 minor_last = U16_MAX;
+    int ret = 0;
+
+    if (info->attrs[DSIM_EVENTS_A_MINOR_FIRST]) {
+        minor_first = nla_get_u32(info->attrs[DSIM_EVENTS_A_MINOR_FIRST]);
+    }
+    if (info->attrs[DSIM_EVENTS_A_MINOR_LAST]) {
+        minor_last = nla_get_u32(info->attrs[DSIM_EVENTS_A_MINOR_LAST]);
+    }
+    if (minor_first > minor_last) {
+        return -EINVAL;
+    }
+
+    new = kmalloc(sizeof(*new), GFP_KERNEL);
+    if (!new) {
+        return -ENOMEM;
+    }
+    new->portid = info->snd_portid;
+    new->minor_first = minor_first;
+    new->minor_last = minor_last;
+
+    spin_lock(&dsim_events_list_lock);
+    ev = dsim_events_find(info);
+    if (!ev) {
+        ret = -ENOENT;
+        goto out;
+    }
+    spin_lock(&ev->listeners_lock);
+    // subscribing again moves the range of the socket
+    list_for_each_entry(listener, &ev->listeners, list) {
+        if (listener->portid == info->snd_portid) {
+            listener->minor_first = minor_first;
+            listener->minor_last = minor_last;
+            goto out_unlock;
+        }
+    }
+    if (ev->num_listeners >= DSIM_EVENTS_MAX_LISTENERS) {
+        ret = -ENOSPC;
+        goto out_unlock;
+    }
+    list_add_tail(&new->list, &ev->listeners);
+    WRITE_ONCE(ev->num_listeners, ev->num_listeners + 1);
+    new = NULL;
+out_unlock:
+    spin_unlock(&ev->listeners_lock);
+out:
+    spin_unlock(&dsim_events_list_lock);
+    kfree(new);
+    return ret;
+}
+
+static int dsim_events_unsubscribe(struct sk_buff *skb, struct genl_info *info)
+{
+    struct dsim_events *ev;
+
+    spin_lock(&dsim_events_list_lock);
+    ev = dsim_events_find(info);
+    if (ev) {
+        dsim_events_drop(ev, info->snd_portid);
+    }
+    spin_unlock(&dsim_events_list_lock);
+    return ev ? 0 : -ENOENT;
+}
+
+// a closed socket loses its subscriptions on every bus
+static int dsim_events_netlink_notify(struct notifier_block *nb, unsigned long state, void *data)
+{
+    struct netlink_notify *notify = data;
+    struct dsim_events *ev;
+
+    if (state != NETLINK_URELEASE || notify->protocol != NETLINK_GENERIC ||
+        !net_eq(notify->net, &init_net)) {
+        return NOTIFY_DONE;
+    }
+
+    spin_lock(&dsim_events_list_lock);
+    list_for_each_entry(ev, &dsim_events_list, list) {
+        dsim_events_drop(ev, notify->portid);
+    }
+    spin_unlock(&dsim_events_list_lock);
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block dsim_events_netlink_nb = {
+    .notifier_call = dsim_events_netlink_notify,
+};
+
+// the first bus listed registers the notifier, the last one removed
+// unregisters it
+static int dsim_events_list_add(struct dsim_events *ev)
+{
+    int ret = 0;
+
+    mutex_lock(&dsim_events_mutex);
+    if (list_empty(&dsim_events_list)) {
+        ret = netlink_register_notifier(&dsim_events_netlink_nb);
+    }
+    if (!ret) {
+        spin_lock(&dsim_events_list_lock);
+        list_add(&ev->list, &dsim_events_list);
+        spin_unlock(&dsim_events_list_lock);
+    }
+    mutex_unlock(&dsim_events_mutex);
+    return ret;
+}
+
+static void dsim_events_list_del(struct dsim_events *ev)
+{
+    mutex_lock(&dsim_events_mutex);
+    spin_lock(&dsim_events_list_lock);
+    list_del(&ev->list);
+    spin_unlock(&dsim_events_list_lock);
+    if (list_empty(&dsim_events_list)) {
+        netlink_unregister_notifier(&dsim_events_netlink_nb);
+    }
+    mutex_unlock(&dsim_events_mutex);
+}
+
+static const struct nla_policy dsim_events_policy[DSIM_EVENTS_A_MAX + 1] = {
+    [DSIM_EVENTS_A_MINOR_FIRST] = { .type = NLA_U32 },
+    [DSIM_EVENTS_A_MINOR_LAST] = { .type = NLA_U32 },
+};
+
+static const struct genl_ops dsim_events_ops[] = {
+    {
+        .cmd = DSIM_EVENTS_CMD_SUBSCRIBE,
+        .doit = dsim_events_subscribe,
+        .flags = GENL_ADMIN_PERM,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,2,0)
+        .policy = dsim_events_policy,
+#endif
+    },
+    {
+        .cmd = DSIM_EVENTS_CMD_UNSUBSCRIBE,
+        .doit = dsim_events_unsubscribe,
+        .flags = GENL_ADMIN_PERM,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,2,0)
+        .policy = dsim_events_policy,
+#endif
+    },
+};
+
+static const struct genl_multicast_group dsim_events_mcgrps[] = {
+    { .name = DSIM_EVENTS_GROUP },
+};
+
+struct dsim_events *dsim_events_register(const char *name, u16 module)
+{
+    struct dsim_events *ev;
+    int ret;
+
+    ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+    if (!ev) {
+        return ERR_PTR(-ENOMEM);
+    }
+    spin_lock_init(&ev->lock);
+    INIT_WORK(&ev->work, dsim_events_flush);
+    spin_lock_init(&ev->listeners_lock);
+    INIT_LIST_HEAD(&ev->listeners);
+    ev->module = module;
+
+    strscpy(ev->family.name, name, GENL_NAMSIZ);
+    ev->family.version = DSIM_EVENTS_VERSION;
+    ev->family.maxattr = DSIM_EVENTS_A_MAX;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,2,0)
+    ev->family.policy = dsim_events_policy;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+    ev->family.resv_start_op = DSIM_EVENTS_CMD_MAX + 1;
+#endif
+    ev->family.module = THIS_MODULE;
+    ev->family.ops = dsim_events_ops;
+    ev->family.n_ops = ARRAY_SIZE(dsim_events_ops);
+    ev->family.mcgrps = dsim_events_mcgrps;
+    ev->family.n_mcgrps = ARRAY_SIZE(dsim_events_mcgrps);
+
+    // listed before the family exists, so its first request finds it
+    ret = dsim_events_list_add(ev);
+    if (ret) {
+        kfree(ev);
+        return ERR_PTR(ret);
+    }
+
+    ret = genl_register_family(&ev->family);
+    if (ret) {
+        dsim_events_list_del(ev);
+        kfree(ev);
+        return ERR_PTR(ret);
+    }
+    spin_lock_irq(&ev->lock);
+    ev->registered = true;
+    spin_unlock_irq(&ev->lock);
+    return ev;
+}
+
+void dsim_events_unregister(struct dsim_events *ev)
+{
+    struct dsim_events_listener *listener, *tmp;
+
+    if (IS_ERR_OR_NULL(ev)) {
+        return;
+    }
+    // no event queues the work once the flag is cleared
+    spin_lock_irq(&ev->lock);
+    ev->registered = false;
+    spin_unlock_irq(&ev->lock);
+    cancel_work_sync(&ev->work);
+    genl_unregister_family(&ev->family);
+    dsim_events_list_del(ev);
+
+    list_for_each_entry_safe(listener, tmp, &ev->listeners, list) {
+        list_del(&listener->list);
+        kfree(listener);
+    }
+    kfree(ev);
+}
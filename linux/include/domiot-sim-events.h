@@ -0,0 +1,73 @@
+#ifndef _DOMIOT_SIM_EVENTS_H
+#define _DOMIOT_SIM_EVENTS_H
+
+// State change events over generic netlink. ihubx24-sim, iohubx24-sim,
+// phidgetvintx6 and video-sim each register a family named after the
+// module ("ihubx24_sim", "iohubx24_sim", "phidgetvintx6", "video_sim")
+// with a multicast group "events". A supervisor opens one socket, joins
+// the groups of the modules it watches and receives the changes of all
+// their devices, batched in DSIM_EVENTS_CMD_EVENTS messages.
+//
+// A socket that only wants some devices of a module sends
+// DSIM_EVENTS_CMD_SUBSCRIBE with a range of minors instead of joining the
+// group; the module then sends it the events of those devices only, until
+// DSIM_EVENTS_CMD_UNSUBSCRIBE or the socket is closed. Both commands need
+// CAP_NET_ADMIN.
+
+#include <linux/types.h>
+
+#define DSIM_EVENTS_GROUP "events"
+#define DSIM_EVENTS_VERSION 1
+
+// module of an event, one per family
+#define DSIM_EVENTS_IHUBX24        1
+#define DSIM_EVENTS_IOHUBX24       2
+#define DSIM_EVENTS_PHIDGETVINTX6  3
+#define DSIM_EVENTS_VIDEO          4
+
+struct dsim_event {
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC time of the change
+    __u64 seq;              // change number of the device, a gap means changes were missed
+    __u32 state;            // bit n = channel n, the playback state for video-sim
+    __u16 module;           // DSIM_EVENTS_IHUBX24, ...
+    __u16 minor;
+};
+
+enum {
+    DSIM_EVENTS_CMD_UNSPEC,
+    DSIM_EVENTS_CMD_EVENTS,         // kernel to user: DSIM_EVENTS_A_EVENTS
+    DSIM_EVENTS_CMD_SUBSCRIBE,      // user to kernel: optional minor range
+    DSIM_EVENTS_CMD_UNSUBSCRIBE,
+    __DSIM_EVENTS_CMD_MAX,
+};
+#define DSIM_EVENTS_CMD_MAX (__DSIM_EVENTS_CMD_MAX - 1)
+
+enum {
+    DSIM_EVENTS_A_UNSPEC,
+    DSIM_EVENTS_A_EVENTS,           // array of struct dsim_event
+    DSIM_EVENTS_A_DROPPED,          // u32, events lost before this batch
+    DSIM_EVENTS_A_MINOR_FIRST,      // u32, default 0
+    DSIM_EVENTS_A_MINOR_LAST,       // u32, default the last minor
+    __DSIM_EVENTS_A_MAX,
+};
+#define DSIM_EVENTS_A_MAX (__DSIM_EVENTS_A_MAX - 1)
+
+#ifdef __KERNEL__
+
+// Events are appended to a buffer from any context and sent from a work
+// item, so a burst of changes costs one message per batch. While nobody
+// listens dsim_event() returns after two reads. The implementation is in
+// domiot-sim-events.c, which the Makefile of every module using it links.
+struct dsim_events;
+
+// name is the family name, module one of DSIM_EVENTS_IHUBX24, ...;
+// returns the event bus of the module or an ERR_PTR()
+struct dsim_events *dsim_events_register(const char *name, u16 module);
+// after the devices are gone, so no more events are added; ev may be NULL
+// or an error from dsim_events_register()
+void dsim_events_unregister(struct dsim_events *ev);
+void dsim_event(struct dsim_events *ev, u16 minor, u64 seq, u64 timestamp_ns, u32 state);
+
+#endif // __KERNEL__
+
+#endif
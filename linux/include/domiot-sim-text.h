@@ -0,0 +1,136 @@
+#ifndef _DOMIOT_SIM_TEXT_H
+#define _DOMIOT_SIM_TEXT_H
+
+// Parsers and formatters of the simulators' text formats. They work on
+// plain buffers without device state, locks or user copies, so the KUnit
+// suite in linux/kunit tests and times the code the modules run.
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/time.h>
+#include <linux/bits.h>
+
+// append the '0'/'1' digits of buf to states starting at channel pos, up
+// to max channels, and set the matching bits of *bits unless it is NULL;
+// anything else is ignored. Returns the number of channels set.
+static inline int dsim_parse_digits(const char *buf, size_t n, char *states, u32 *bits, int pos, int max)
+{
+    size_t i;
+
+    for (i = 0; i < n && pos < max; i++) {
+        if (buf[i] == '0' || buf[i] == '1') {
+            states[pos] = buf[i];
+            if (bits && buf[i] == '1') {
+                *bits |= BIT(pos);
+            }
+            pos++;
+        }
+    }
+    return pos;
+}
+
+// copy the printable characters of in to out, newlines and carriage returns
+// become spaces and everything else is dropped; out holds at most max
+// characters plus the terminating NUL. Returns the length of out.
+static inline int dsim_sanitize_text(const char *in, size_t len, char *out, int max)
+{
+    int out_len = 0;
+    size_t i;
+
+    for (i = 0; i < len && out_len < max; i++) {
+        if (in[i] == '\n' || in[i] == '\r') {
+            out[out_len++] = ' ';
+        } else if (in[i] >= 32 && in[i] <= 126) {
+            out[out_len++] = in[i];
+        }
+    }
+    out[out_len] = '\0';
+    return out_len;
+}
+
+// parse the value of video-sim's SET CURRENT_TIME, either whole seconds
+// ("12") or seconds and up to three fractional digits ("12.5" is 12500 ms);
+// returns 0 and the position in *position_ms, or -EINVAL
+static inline int dsim_parse_current_time(const char *time_str, unsigned long *position_ms)
+{
+    const char *dot_pos = strchr(time_str, '.');
+    unsigned long seconds_part = 0;
+    unsigned long ms_part = 0;
+
+    if (dot_pos) {
+        // Parse seconds.milliseconds format
+        char seconds_str[24] = {0};
+        char ms_str[8] = {0};
+        int seconds_len = dot_pos - time_str;
+        int ms_len = strlen(dot_pos + 1);
+
+        if (seconds_len >= sizeof(seconds_str) || ms_len > 3) {
+            return -EINVAL;
+        }
+        memcpy(seconds_str, time_str, seconds_len);
+        memcpy(ms_str, dot_pos + 1, ms_len);
+
+        // Pad milliseconds to 3 digits: .1 -> 100ms, .12 -> 120ms
+        if (ms_len == 1) {
+            strcat(ms_str, "00");
+        } else if (ms_len == 2) {
+            strcat(ms_str, "0");
+        }
+
+        if (kstrtoul(seconds_str, 10, &seconds_part) != 0 ||
+            kstrtoul(ms_str, 10, &ms_part) != 0) {
+            return -EINVAL;
+        }
+    } else {
+        // Parse integer seconds format
+        if (kstrtoul(time_str, 10, &seconds_part) != 0) {
+            return -EINVAL;
+        }
+    }
+
+    if (seconds_part > (ULONG_MAX - ms_part) / 1000) {
+        return -EINVAL;
+    }
+    *position_ms = seconds_part * 1000 + ms_part;
+    return 0;
+}
+
+// "YYYY-MM-DD HH:MM:SS " in UTC, the prefix of every log line
+static inline int dsim_format_log_time(char *buf, size_t size, u64 timestamp_ns)
+{
+    struct tm tm;
+
+    time64_to_tm(div_u64(timestamp_ns, NSEC_PER_SEC), 0, &tm);
+    return scnprintf(buf, size, "%04ld-%02d-%02d %02d:%02d:%02d ",
+                     tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                     tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+// "YYYY-MM-DD HH:MM:SS <num digits>\n", digit n is bit n of outputs; the
+// line is cut to size - 1 bytes and not NUL terminated. Returns its length.
+static inline int dsim_format_outputs_record(char *buf, size_t size, u64 timestamp_ns, u32 outputs, int num)
+{
+    int i, len;
+
+    if (size == 0) {
+        return 0;
+    }
+    len = dsim_format_log_time(buf, size, timestamp_ns);
+    for (i = 0; i < num && len < size - 1; i++) {
+        buf[len++] = (outputs & BIT(i)) ? '1' : '0';
+    }
+    if (len < size - 1) {
+        buf[len++] = '\n';
+    }
+    return len;
+}
+
+// "YYYY-MM-DD HH:MM:SS <text>\n", cut like scnprintf(). Returns its length.
+static inline int dsim_format_text_record(char *buf, size_t size, u64 timestamp_ns, const char *text, int len)
+{
+    int n = dsim_format_log_time(buf, size, timestamp_ns);
+
+    return n + scnprintf(buf + n, size - n, "%.*s\n", len, text);
+}
+
+#endif
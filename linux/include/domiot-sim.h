@@ -0,0 +1,200 @@
+#ifndef _DOMIOT_SIM_H
+#define _DOMIOT_SIM_H
+
+// Code shared by the simulator modules. Everything here is a macro or a
+// static inline, so each module keeps building and loading on its own.
+// The debug macros use the module's DEVICE_NAME and debug_level.
+
+#include <linux/version.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/atomic.h>
+#include <linux/wait.h>
+#include <linux/percpu.h>
+#include <linux/uio.h>
+#include <linux/rcupdate.h>
+
+// domiot-sim.ko links the simulators into one module. There each one
+// hands its init and exit functions to the bundle instead of registering
+// them, and its parameters get the prefix its wrapper file defines as
+// DSIM_PARAM_PREFIX, e.g. ihub.queue_size.
+#ifdef DOMIOT_SIM_BUNDLE
+    #ifdef DSIM_PARAM_PREFIX
+        #undef MODULE_PARAM_PREFIX
+        #define MODULE_PARAM_PREFIX DSIM_PARAM_PREFIX
+    #endif
+    #define __dsim_exit
+    #define DSIM_MODULE(name, init_fn, exit_fn) \
+        int __init name##_bundle_init(void) { return init_fn(); } \
+        void name##_bundle_exit(void) { exit_fn(); }
+    // functions of the other simulators are linked in directly
+    #define dsim_symbol_get(sym) (&(sym))
+    #define dsim_symbol_put(sym) do { } while (0)
+#else
+    #define __dsim_exit __exit
+    #define DSIM_MODULE(name, init_fn, exit_fn) \
+        module_init(init_fn); \
+        module_exit(exit_fn);
+    // functions of the other simulators are found at runtime, NULL while
+    // their module is not loaded
+    #define dsim_symbol_get(sym) symbol_get(sym)
+    #define dsim_symbol_put(sym) symbol_put(sym)
+#endif
+
+// compatibility macros
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+    #define CLASS_CREATE_COMPAT(name) class_create(name)
+    #define CLASS_ATTR_CONST_COMPAT const
+    #define ITER_IOV_COMPAT(iter) iter_iov(iter)
+#else
+    #define CLASS_CREATE_COMPAT(name) class_create(THIS_MODULE, name)
+    #define CLASS_ATTR_CONST_COMPAT
+    #define ITER_IOV_COMPAT(iter) ((iter)->iov)
+#endif
+
+// debug macros to reduce overhead
+// debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
+#define dbg_err(fmt, ...) printk(KERN_ERR DEVICE_NAME ": " fmt, ##__VA_ARGS__)
+#define dbg_info(level, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO DEVICE_NAME ": " fmt, ##__VA_ARGS__); } while(0)
+#define dbg_dev_info(level, dev_id, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO DEVICE_NAME "%d: " fmt, dev_id, ##__VA_ARGS__); } while(0)
+
+// Reader notification: every state change moves the generation forward and
+// readers sleep on one waitqueue per device until it differs from the
+// generation they last returned. Writers publish under their state lock and
+// may wake once for a batch of changes.
+struct dsim_notifier {
+    atomic64_t generation;
+    wait_queue_head_t wait;
+};
+
+static inline void dsim_notifier_init(struct dsim_notifier *n)
+{
+    atomic64_set(&n->generation, 0);
+    init_waitqueue_head(&n->wait);
+}
+
+static inline u64 dsim_generation(struct dsim_notifier *n)
+{
+    return atomic64_read(&n->generation);
+}
+
+static inline bool dsim_pending(struct dsim_notifier *n, u64 seen_generation)
+{
+    return atomic64_read(&n->generation) != seen_generation;
+}
+
+// fully ordered, so the new state is visible to a reader that sees the
+// new generation; returns the new generation
+static inline u64 dsim_publish(struct dsim_notifier *n)
+{
+    return atomic64_inc_return(&n->generation);
+}
+
+static inline void dsim_wake(struct dsim_notifier *n)
+{
+    wake_up_interruptible(&n->wait);
+}
+
+// Aggregate readers follow every device of a module through one file. The
+// changes of all devices are only counted while such a file is open, so
+// without one a change costs a read of the reader count.
+struct dsim_fleet {
+    struct dsim_notifier notify;
+    atomic_t readers;
+};
+
+static inline void dsim_fleet_init(struct dsim_fleet *f)
+{
+    dsim_notifier_init(&f->notify);
+    atomic_set(&f->readers, 0);
+}
+
+static inline void dsim_fleet_publish(struct dsim_fleet *f)
+{
+    if (atomic_read(&f->readers)) {
+        dsim_publish(&f->notify);
+    }
+}
+
+// the waitqueue lock is shared by all devices, only take it for sleepers
+static inline void dsim_fleet_wake(struct dsim_fleet *f)
+{
+    if (wq_has_sleeper(&f->notify.wait)) {
+        dsim_wake(&f->notify);
+    }
+}
+
+// Per-CPU operation counters: a module keeps a struct of u64 fields from
+// alloc_percpu(), bumps them with this_cpu_inc/this_cpu_add and exports
+// each field as a read-only attribute that sums it over all CPUs.
+static inline u64 dsim_stats_sum(void __percpu *stats, size_t offset)
+{
+    u64 sum = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        sum += *(u64 *)((char *)per_cpu_ptr(stats, cpu) + offset);
+    }
+    return sum;
+}
+
+// dev_type is the driver data of the class device and has a 'stats' member
+#define DSIM_STATS_ATTR(dev_type, stats_type, field) \
+    static ssize_t stats_##field##_show(struct device *dev, struct device_attribute *attr, char *buf) \
+    { \
+        dev_type *sim_dev = dev_get_drvdata(dev); \
+        if (!sim_dev) return -ENODEV; \
+        return sprintf(buf, "%llu\n", dsim_stats_sum(sim_dev->stats, offsetof(stats_type, field))); \
+    } \
+    static struct device_attribute dev_attr_stats_##field = __ATTR(field, 0444, stats_##field##_show, NULL)
+
+// Functions the simulators export to each other, states have bit n =
+// channel n. They look the device up by minor and fail with -ENODEV if
+// it does not exist.
+int ihubx24_sim_get_inputs(int minor, u32 *state);
+int iohubx24_sim_get_channels(int minor, u32 *state);
+int iohubx24_sim_set_channels(int minor, u32 mask, u32 value);
+int ohubx24_sim_set_outputs(int minor, u32 outputs);
+
+// Wiring: ihubx24-sim inputs can follow the output channels of ohubx24-sim
+// and iohubx24-sim devices. Each source keeps a hook that ihubx24-sim sets
+// through the source's set_wire_hook function while both are loaded, so
+// every module still loads on its own and a source pays one RCU read per
+// output change. ihubx24-sim clears the hooks before it unloads.
+#define DSIM_WIRE_OHUBX24 1
+#define DSIM_WIRE_IOHUBX24 2
+
+typedef void (*dsim_wire_fn)(int source, int minor, u32 state);
+
+void ohubx24_sim_set_wire_hook(dsim_wire_fn fn);
+void iohubx24_sim_set_wire_hook(dsim_wire_fn fn);
+
+// pass a new output state of a source device to the hook, if one is set
+static inline void dsim_wire_outputs(dsim_wire_fn __rcu *hook, int source, int minor, u32 state)
+{
+    dsim_wire_fn wire_outputs;
+
+    rcu_read_lock();
+    wire_outputs = rcu_dereference(*hook);
+    if (wire_outputs) {
+        wire_outputs(source, minor, state);
+    }
+    rcu_read_unlock();
+}
+
+// bytes left in the current iovec segment, every segment is one frame
+static inline size_t iter_segment_len(const struct iov_iter *iter)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+    if (iter_is_ubuf(iter)) {
+        return iov_iter_count(iter);
+    }
+#endif
+    if (iter_is_iovec(iter)) {
+        return min(iov_iter_count(iter), ITER_IOV_COMPAT(iter)->iov_len - iter->iov_offset);
+    }
+    return iov_iter_count(iter);
+}
+
+#endif
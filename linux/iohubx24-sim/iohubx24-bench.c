@@ -0,0 +1,456 @@
+// Throughput and latency benchmark for /dev/iohubx24-sim*.
+//
+// Writer threads write 24-channel states as fast as they can while reader
+// threads (blocking and epoll based) read timestamped records. The latency of
+// a record is the time from the kernel applying the write (the record
+// timestamp, CLOCK_MONOTONIC) to the reader getting it back from read().
+// Results are printed as a single JSON object.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+
+#include "iohubx24-sim.h"
+
+#define FRAME_SIZE (IOHUBX24_NUM_CHANNELS + 1)
+#define READ_BATCH 16
+
+// log-linear latency histogram: 16 sub-buckets per power of two, so the
+// reported percentiles are within 1/16 of the measured value
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+enum thread_kind {
+    WRITER,
+    BLOCKING_READER,
+    EPOLL_READER,
+};
+
+typedef struct {
+    pthread_t thread;
+    enum thread_kind kind;
+    int fd;
+    int epfd;
+    int error;
+    unsigned long long ops;
+    unsigned long long bytes;
+    unsigned long long eagain;
+    unsigned long long seq_gaps;    // changes a reader never saw
+    long voluntary_switches;
+    long involuntary_switches;
+    unsigned long long *hist;
+} thread_info_t;
+
+static const char *device_path = "/dev/iohubx24-sim0";
+static int num_writers = 1;
+static int num_blocking_readers = 1;
+static int num_epoll_readers = 1;
+static int duration_s = 10;
+static const char *output_path = NULL;
+
+static volatile int running = 1;
+static unsigned int next_state = 0;
+
+static void wakeup_handler(int sig)
+{
+    // only used to interrupt blocking reads and writes
+}
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int hist_index(unsigned long long v)
+{
+    int msb;
+
+    if (v < HIST_SUB) {
+        return (int)v;
+    }
+    msb = 63 - __builtin_clzll(v);
+    return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) |
+           (int)((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// upper bound of the values counted in bucket i
+static unsigned long long hist_value(int i)
+{
+    int shift;
+
+    if (i < HIST_SUB) {
+        return i;
+    }
+    shift = (i >> HIST_SUB_BITS) - 1;
+    return ((unsigned long long)(HIST_SUB | (i & (HIST_SUB - 1))) << shift) +
+           (1ULL << shift) - 1;
+}
+
+static unsigned long long hist_percentile(const unsigned long long *hist, unsigned long long total, double p)
+{
+    unsigned long long target = (unsigned long long)(total * p);
+    unsigned long long seen = 0;
+
+    if (total == 0) {
+        return 0;
+    }
+    if (target >= total) {
+        target = total - 1;
+    }
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > target) {
+            return hist_value(i);
+        }
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+static void record_switches(thread_info_t *info)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        info->voluntary_switches = usage.ru_nvcsw;
+        info->involuntary_switches = usage.ru_nivcsw;
+    }
+}
+
+static void account_records(thread_info_t *info, const struct iohubx24_record *recs, int count,
+                            unsigned long long *last_seq)
+{
+    unsigned long long now = now_ns();
+
+    for (int i = 0; i < count; i++) {
+        unsigned long long latency = now > recs[i].timestamp_ns ? now - recs[i].timestamp_ns : 0;
+        info->hist[hist_index(latency)]++;
+        if (*last_seq && recs[i].seq > *last_seq + 1) {
+            info->seq_gaps += recs[i].seq - *last_seq - 1;
+        }
+        *last_seq = recs[i].seq;
+    }
+    info->ops += count;
+    info->bytes += count * sizeof(*recs);
+}
+
+// writes a fresh state so that every write is a change and wakes the readers
+static ssize_t write_next_state(int fd)
+{
+    char frame[FRAME_SIZE];
+    unsigned int state = __atomic_fetch_add(&next_state, 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < IOHUBX24_NUM_CHANNELS; i++) {
+        frame[i] = (state >> i) & 1 ? '1' : '0';
+    }
+    frame[IOHUBX24_NUM_CHANNELS] = '\n';
+    return write(fd, frame, FRAME_SIZE);
+}
+
+static void *writer_thread(void *arg)
+{
+    thread_info_t *info = arg;
+
+    while (running) {
+        ssize_t n = write_next_state(info->fd);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            info->error = errno;
+            break;
+        }
+        info->ops++;
+        info->bytes += n;
+    }
+    record_switches(info);
+    return NULL;
+}
+
+static void *blocking_reader_thread(void *arg)
+{
+    thread_info_t *info = arg;
+    struct iohubx24_record recs[READ_BATCH];
+    unsigned long long last_seq = 0;
+
+    while (running) {
+        ssize_t n = read(info->fd, recs, sizeof(recs));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            info->error = errno;
+            break;
+        }
+        account_records(info, recs, n / sizeof(recs[0]), &last_seq);
+    }
+    record_switches(info);
+    return NULL;
+}
+
+static void *epoll_reader_thread(void *arg)
+{
+    thread_info_t *info = arg;
+    struct iohubx24_record recs[READ_BATCH];
+    struct epoll_event event;
+    unsigned long long last_seq = 0;
+
+    while (running) {
+        int ready = epoll_wait(info->epfd, &event, 1, 100);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            info->error = errno;
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        // drain until the device reports no new change
+        for (;;) {
+            ssize_t n = read(info->fd, recs, sizeof(recs));
+            if (n < 0) {
+                if (errno == EAGAIN) {
+                    info->eagain++;
+                } else if (errno != EINTR) {
+                    info->error = errno;
+                    running = 0;
+                }
+                break;
+            }
+            account_records(info, recs, n / sizeof(recs[0]), &last_seq);
+        }
+    }
+    record_switches(info);
+    return NULL;
+}
+
+static int open_thread_fd(thread_info_t *info)
+{
+    int flags = info->kind == WRITER ? O_WRONLY : O_RDONLY;
+
+    if (info->kind == EPOLL_READER) {
+        flags |= O_NONBLOCK;
+    }
+    info->fd = open(device_path, flags);
+    if (info->fd < 0) {
+        fprintf(stderr, "ERROR: Failed to open %s: %s\n", device_path, strerror(errno));
+        return -1;
+    }
+    if (info->kind == WRITER) {
+        return 0;
+    }
+    if (ioctl(info->fd, IOHUBX24_IOC_SET_READ_MODE, IOHUBX24_READ_RECORD) < 0) {
+        fprintf(stderr, "ERROR: Failed to select record reads: %s\n", strerror(errno));
+        return -1;
+    }
+    if (info->kind == EPOLL_READER) {
+        struct epoll_event event = { .events = EPOLLIN };
+        info->epfd = epoll_create1(0);
+        if (info->epfd < 0 || epoll_ctl(info->epfd, EPOLL_CTL_ADD, info->fd, &event) < 0) {
+            fprintf(stderr, "ERROR: Failed to set up epoll: %s\n", strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static const char *kind_name(enum thread_kind kind)
+{
+    switch (kind) {
+    case WRITER:
+        return "writer";
+    case BLOCKING_READER:
+        return "blocking_reader";
+    default:
+        return "epoll_reader";
+    }
+}
+
+static void print_results(FILE *out, thread_info_t *threads, int count, double elapsed_s)
+{
+    static unsigned long long hist[HIST_BUCKETS];
+    unsigned long long writes = 0, reads = 0, eagain = 0, seq_gaps = 0, samples = 0;
+    long voluntary = 0, involuntary = 0;
+    struct utsname uts;
+
+    for (int i = 0; i < count; i++) {
+        thread_info_t *t = &threads[i];
+        if (t->kind == WRITER) {
+            writes += t->ops;
+        } else {
+            reads += t->ops;
+            eagain += t->eagain;
+            seq_gaps += t->seq_gaps;
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                hist[b] += t->hist[b];
+                samples += t->hist[b];
+            }
+        }
+        voluntary += t->voluntary_switches;
+        involuntary += t->involuntary_switches;
+    }
+    uname(&uts);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"kernel\": \"%s\",\n", uts.release);
+    fprintf(out, "  \"device\": \"%s\",\n", device_path);
+    fprintf(out, "  \"writers\": %d,\n", num_writers);
+    fprintf(out, "  \"blocking_readers\": %d,\n", num_blocking_readers);
+    fprintf(out, "  \"epoll_readers\": %d,\n", num_epoll_readers);
+    fprintf(out, "  \"duration_s\": %.3f,\n", elapsed_s);
+    fprintf(out, "  \"writes\": %llu,\n", writes);
+    fprintf(out, "  \"reads\": %llu,\n", reads);
+    fprintf(out, "  \"writes_per_s\": %.1f,\n", writes / elapsed_s);
+    fprintf(out, "  \"reads_per_s\": %.1f,\n", reads / elapsed_s);
+    fprintf(out, "  \"missed_changes\": %llu,\n", seq_gaps);
+    fprintf(out, "  \"eagain\": %llu,\n", eagain);
+    fprintf(out, "  \"latency_ns\": { \"p50\": %llu, \"p99\": %llu, \"p999\": %llu },\n",
+            hist_percentile(hist, samples, 0.50),
+            hist_percentile(hist, samples, 0.99),
+            hist_percentile(hist, samples, 0.999));
+    fprintf(out, "  \"context_switches\": { \"voluntary\": %ld, \"involuntary\": %ld },\n",
+            voluntary, involuntary);
+    fprintf(out, "  \"threads\": [\n");
+    for (int i = 0; i < count; i++) {
+        thread_info_t *t = &threads[i];
+        fprintf(out, "    { \"kind\": \"%s\", \"ops\": %llu, \"bytes\": %llu, "
+                "\"voluntary_switches\": %ld, \"involuntary_switches\": %ld }%s\n",
+                kind_name(t->kind), t->ops, t->bytes,
+                t->voluntary_switches, t->involuntary_switches, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  -d <device>   device to use (default %s)\n", device_path);
+    printf("  -w <n>        writer threads (default %d)\n", num_writers);
+    printf("  -r <n>        blocking reader threads (default %d)\n", num_blocking_readers);
+    printf("  -e <n>        epoll reader threads (default %d)\n", num_epoll_readers);
+    printf("  -t <seconds>  duration (default %d)\n", duration_s);
+    printf("  -o <file>     write the JSON results to file instead of stdout\n");
+}
+
+int main(int argc, char *argv[])
+{
+    thread_info_t *threads;
+    struct sigaction sa;
+    unsigned long long start, end;
+    int count, opt, result = 0;
+    FILE *out = stdout;
+
+    while ((opt = getopt(argc, argv, "d:w:r:e:t:o:h")) != -1) {
+        switch (opt) {
+        case 'd': device_path = optarg; break;
+        case 'w': num_writers = atoi(optarg); break;
+        case 'r': num_blocking_readers = atoi(optarg); break;
+        case 'e': num_epoll_readers = atoi(optarg); break;
+        case 't': duration_s = atoi(optarg); break;
+        case 'o': output_path = optarg; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (num_writers < 1 || num_blocking_readers < 0 || num_epoll_readers < 0 || duration_s < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // without SA_RESTART so that pthread_kill() interrupts blocked reads
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = wakeup_handler;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    count = num_writers + num_blocking_readers + num_epoll_readers;
+    threads = calloc(count, sizeof(*threads));
+    if (!threads) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        thread_info_t *t = &threads[i];
+        t->epfd = -1;
+        t->kind = i < num_writers ? WRITER :
+                  i < num_writers + num_blocking_readers ? BLOCKING_READER : EPOLL_READER;
+        t->hist = calloc(HIST_BUCKETS, sizeof(*t->hist));
+        if (!t->hist || open_thread_fd(t) < 0) {
+            return 1;
+        }
+    }
+
+    // readers first so that they are waiting when the first write lands
+    start = now_ns();
+    for (int i = count - 1; i >= 0; i--) {
+        thread_info_t *t = &threads[i];
+        void *(*fn)(void *) = t->kind == WRITER ? writer_thread :
+                              t->kind == BLOCKING_READER ? blocking_reader_thread : epoll_reader_thread;
+        if (pthread_create(&t->thread, NULL, fn, t) != 0) {
+            fprintf(stderr, "ERROR: Failed to start thread %d\n", i);
+            return 1;
+        }
+    }
+
+    sleep(duration_s);
+    running = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_kill(threads[i].thread, SIGUSR1);
+    }
+    for (int i = 0; i < num_writers; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    end = now_ns();
+    // a reader that checked running just before the signal arrived is still
+    // blocked in read(), one more change releases it
+    write_next_state(threads[0].fd);
+    for (int i = num_writers; i < count; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (threads[i].error) {
+            fprintf(stderr, "ERROR: %s thread %d failed: %s\n", kind_name(threads[i].kind), i,
+                    strerror(threads[i].error));
+            result = 1;
+        }
+    }
+
+    if (output_path) {
+        out = fopen(output_path, "w");
+        if (!out) {
+            fprintf(stderr, "ERROR: Failed to open %s: %s\n", output_path, strerror(errno));
+            return 1;
+        }
+    }
+    print_results(out, threads, count, (end - start) / 1e9);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (int i = 0; i < count; i++) {
+        close(threads[i].fd);
+        if (threads[i].epfd >= 0) {
+            close(threads[i].epfd);
+        }
+        free(threads[i].hist);
+    }
+    free(threads);
+    return result;
+}
@@ -0,0 +1,1224 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/device.h>
+#include <linux/cdev.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/version.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/atomic.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/idr.h>
+#include <linux/uio.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-text.h"
+#include "domiot-sim-events.h"
+#include "iohubx24-sim.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
+#define DEVICE_NAME "iohubx24-sim"
+#define CLASS_NAME "iohubx24"
+#define NUM_CHANNELS 24
+#define BUFFER_SIZE (NUM_CHANNELS + 1)
+#define MAX_DEVICES 1024
+// /dev/iohubx24-sim-all follows the minors of the devices
+#define ALL_MINOR MAX_DEVICES
+#define NUM_MINORS (MAX_DEVICES + 1)
+// a snapshot is taken again while devices change under it, this many times
+#define SNAPSHOT_PASSES 4
+#define CHANNELS_MASK GENMASK(NUM_CHANNELS - 1, 0)
+// bucket n counts latencies in [2^n, 2^(n+1)) ns, the last one everything above
+#define LATENCY_BUCKETS 32
+
+// compatibility macros
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+    #define VM_FLAGS_CLEAR_COMPAT(vma, flags) vm_flags_clear(vma, flags)
+#else
+    #define VM_FLAGS_CLEAR_COMPAT(vma, flags) ((vma)->vm_flags &= ~(flags))
+#endif
+
+// debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
+static int debug_level = 1;
+module_param(debug_level, int, 0644);
+MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
+
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the iohub parameter of domiot-sim.ko
+extern int domiot_sim_iohub;
+#define num_devices domiot_sim_iohub
+#else
+static int num_devices = 1;
+module_param(num_devices, int, 0644);
+MODULE_PARM_DESC(num_devices, "Number of iohubx24-sim devices to create at load time (default: 1, max: 1024)");
+#endif
+
+// operation counters, per CPU so that concurrent readers and writers never
+// share a cache line; the stats attributes sum them over all CPUs
+struct iohubx24_stats {
+    u64 reads;
+    u64 writes;
+    u64 bytes_in;
+    u64 bytes_out;
+    u64 state_changes;
+    u64 wakeups;
+    u64 eagain;
+    u64 conflated;      // changes a reader never saw because a newer one replaced them
+    u64 filtered;       // changes a masked reader was not woken for
+};
+
+struct iohubx24_reader {
+    // NULL for readers of the aggregate file
+    struct iohubx24_device *device;
+    // generation returned by the last read
+    u64 seen_generation;
+    // IOHUBX24_READ_TEXT or IOHUBX24_READ_RECORD
+    unsigned int read_mode;
+    // set by IOHUBX24_IOC_SET_MASK: the reader then sleeps on its own
+    // waitqueue and is woken, with wanted_generation moved to the change,
+    // only when one of the channels in mask changed
+    struct list_head masked_list;
+    bool masked;
+    u32 mask;
+    u64 wanted_generation;
+    wait_queue_head_t wait;
+};
+
+struct iohubx24_device {
+    dev_t dev_num;
+    struct device *device;
+    int minor;
+    // open files, delete_device is refused while non-zero; a mapping of
+    // the state page keeps its file open
+    unsigned int open_count;
+    char channel_states[NUM_CHANNELS];
+    char prev_channel_states[NUM_CHANNELS];
+    struct mutex state_mutex;
+    // readers sleep until the generation moves past their seen_generation
+    struct dsim_notifier notify;
+    // readers with a channel mask, woken one by one, under state_mutex
+    struct list_head masked_readers_list;
+    struct iohubx24_state_page *state_page;
+    // commit to wakeup latency of blocked readers, exposed in debugfs
+    atomic64_t latency_hist[LATENCY_BUCKETS];
+    struct dentry *debugfs_dir;
+    struct iohubx24_stats __percpu *stats;
+};
+
+static int major_number;
+static struct class *iohubx24_class = NULL;
+// readers are allocated on every open, from a dedicated cache
+static struct kmem_cache *reader_cache;
+static struct cdev iohubx24_cdev;
+static struct cdev iohubx24_all_cdev;
+static struct device *all_device;
+// any change of any device, for the aggregate file
+static struct dsim_fleet fleet;
+static struct dentry *iohubx24_debugfs_root;
+// devices by minor, devices_mutex protects the table and open_count
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
+// state change events of all the devices, see domiot-sim-events.h
+static struct dsim_events *event_bus;
+// ihubx24-sim's wiring entry point while it is loaded, see domiot-sim.h
+static dsim_wire_fn __rcu wire_hook;
+
+static int device_open(struct inode *, struct file *);
+static int device_release(struct inode *, struct file *);
+static ssize_t device_read_iter(struct kiocb *, struct iov_iter *);
+static ssize_t device_write_iter(struct kiocb *, struct iov_iter *);
+static unsigned int device_poll(struct file *, struct poll_table_struct *);
+static int device_mmap(struct file *, struct vm_area_struct *);
+static long device_ioctl(struct file *, unsigned int, unsigned long);
+
+static struct file_operations fops = {
+    .open = device_open,
+    .read_iter = device_read_iter,
+    .write_iter = device_write_iter,
+    .release = device_release,
+    .poll = device_poll,
+    .mmap = device_mmap,
+    .unlocked_ioctl = device_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+};
+
+static int all_open(struct inode *, struct file *);
+static int all_release(struct inode *, struct file *);
+static ssize_t all_read_iter(struct kiocb *, struct iov_iter *);
+static unsigned int all_poll(struct file *, struct poll_table_struct *);
+
+static struct file_operations all_fops = {
+    .open = all_open,
+    .read_iter = all_read_iter,
+    .release = all_release,
+    .poll = all_poll,
+};
+
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct iohubx24_device, struct iohubx24_stats, field)
+
+STATS_ATTR(reads);
+STATS_ATTR(writes);
+STATS_ATTR(bytes_in);
+STATS_ATTR(bytes_out);
+STATS_ATTR(state_changes);
+STATS_ATTR(wakeups);
+STATS_ATTR(eagain);
+STATS_ATTR(conflated);
+STATS_ATTR(filtered);
+
+static struct attribute *iohubx24_stats_attrs[] = {
+    &dev_attr_stats_reads.attr,
+    &dev_attr_stats_writes.attr,
+    &dev_attr_stats_bytes_in.attr,
+    &dev_attr_stats_bytes_out.attr,
+    &dev_attr_stats_state_changes.attr,
+    &dev_attr_stats_wakeups.attr,
+    &dev_attr_stats_eagain.attr,
+    &dev_attr_stats_conflated.attr,
+    &dev_attr_stats_filtered.attr,
+    NULL,
+};
+
+// /sys/class/iohubx24/iohubx24-simN/stats/
+static const struct attribute_group iohubx24_stats_group = {
+    .name = "stats",
+    .attrs = iohubx24_stats_attrs,
+};
+
+// publish channel states to the mmap page, caller holds state_mutex
+static void update_state_page(struct iohubx24_device *dev)
+{
+    struct iohubx24_state_page *page = dev->state_page;
+
+    WRITE_ONCE(page->seq, page->seq + 1);
+    smp_wmb();
+
+    page->generation++;
+    page->last_change_ns = ktime_get_ns();
+    memcpy(page->channel_states, dev->channel_states, NUM_CHANNELS);
+
+    smp_wmb();
+    WRITE_ONCE(page->seq, page->seq + 1);
+}
+
+static u32 channel_states_to_bits(const char *states)
+{
+    u32 bits = 0;
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        if (states[i] == '1') {
+            bits |= BIT(i);
+        }
+    }
+    return bits;
+}
+
+static void bits_to_channel_states(char *states, u32 bits)
+{
+    int i;
+
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        states[i] = (bits & BIT(i)) ? '1' : '0';
+    }
+}
+
+// compare against prev_channel_states and publish a change, caller holds state_mutex
+// so that ihubx24-sim inputs wired to the channels see the changes in order
+static int commit_channel_states(struct iohubx24_device *dev)
+{
+    struct iohubx24_reader *reader;
+    u32 state, changed;
+    u64 seq;
+
+    if (memcmp(dev->channel_states, dev->prev_channel_states, NUM_CHANNELS) == 0) {
+        return 0;
+    }
+    update_state_page(dev);
+    seq = dsim_publish(&dev->notify);
+    dsim_fleet_publish(&fleet);
+    state = channel_states_to_bits(dev->channel_states);
+    changed = channel_states_to_bits(dev->prev_channel_states) ^ state;
+    list_for_each_entry(reader, &dev->masked_readers_list, masked_list) {
+        if (changed & reader->mask) {
+            // the change the reader was woken for is replaced unread
+            if ((s64)(reader->wanted_generation - reader->seen_generation) > 0) {
+                this_cpu_inc(dev->stats->conflated);
+            }
+            WRITE_ONCE(reader->wanted_generation, seq);
+            wake_up_interruptible(&reader->wait);
+        } else {
+            this_cpu_inc(dev->stats->filtered);
+        }
+    }
+    dsim_event(event_bus, dev->minor, seq, dev->state_page->last_change_ns, state);
+    dsim_wire_outputs(&wire_hook, DSIM_WIRE_IOHUBX24, dev->minor, state);
+    this_cpu_inc(dev->stats->state_changes);
+    if (trace_iohubx24_sim_state_change_enabled()) {
+        trace_iohubx24_sim_state_change(dev->minor, channel_states_to_bits(dev->prev_channel_states),
+                                        channel_states_to_bits(dev->channel_states),
+                                        dsim_generation(&dev->notify));
+    }
+    return 1;
+}
+
+// one wakeup regardless of the number of readers
+static void wake_readers(struct iohubx24_device *dev)
+{
+    this_cpu_inc(dev->stats->wakeups);
+    dsim_wake(&dev->notify);
+    dsim_fleet_wake(&fleet);
+}
+
+static inline bool reader_has_data(struct iohubx24_reader *reader)
+{
+    if (READ_ONCE(reader->masked)) {
+        return (s64)(READ_ONCE(reader->wanted_generation) - READ_ONCE(reader->seen_generation)) > 0;
+    }
+    return dsim_pending(&reader->device->notify, READ_ONCE(reader->seen_generation));
+}
+
+static inline wait_queue_head_t *reader_wait(struct iohubx24_reader *reader)
+{
+    return READ_ONCE(reader->masked) ? &reader->wait : &reader->device->notify.wait;
+}
+
+// account the time from the last commit to a blocked reader running again,
+// caller holds state_mutex
+static void account_wakeup_latency(struct iohubx24_device *dev, u64 woken_ns)
+{
+    u64 commit_ns = dev->state_page->last_change_ns;
+    u64 latency = woken_ns > commit_ns ? woken_ns - commit_ns : 0;
+    int bucket = latency ? min_t(int, ilog2(latency), LATENCY_BUCKETS - 1) : 0;
+
+    atomic64_inc(&dev->latency_hist[bucket]);
+    trace_iohubx24_sim_wakeup(dev->minor, dsim_generation(&dev->notify), latency);
+}
+
+static int device_open(struct inode *inodep, struct file *filep)
+{
+    struct iohubx24_reader *reader;
+    struct iohubx24_device *dev;
+    int minor = iminor(inodep);
+    
+    reader = kmem_cache_alloc(reader_cache, GFP_KERNEL);
+    if (!reader) {
+        return -ENOMEM;
+    }
+    
+    // keep the device from being deleted while it is open
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        dev->open_count++;
+    }
+    mutex_unlock(&devices_mutex);
+    if (!dev) {
+        dbg_err("Invalid minor number %d\n", minor);
+        kmem_cache_free(reader_cache, reader);
+        return -ENODEV;
+    }
+    
+    reader->device = dev;
+    // First read should always succeed
+    reader->seen_generation = dsim_generation(&dev->notify) - 1;
+    reader->read_mode = IOHUBX24_READ_TEXT;
+    reader->masked = false;
+    reader->mask = CHANNELS_MASK;
+    init_waitqueue_head(&reader->wait);
+    
+    filep->private_data = reader;
+    trace_iohubx24_sim_open(minor);
+    dbg_dev_info(2, minor, "Device opened\n");
+    return 0;
+}
+
+static int device_release(struct inode *inodep, struct file *filep)
+{
+    struct iohubx24_reader *reader = filep->private_data;
+    int minor = iminor(inodep);
+    
+    if (reader && reader->device) {
+        struct iohubx24_device *dev = reader->device;
+        
+        trace_iohubx24_sim_release(minor);
+        if (reader->masked) {
+            mutex_lock(&dev->state_mutex);
+            list_del(&reader->masked_list);
+            mutex_unlock(&dev->state_mutex);
+        }
+        kmem_cache_free(reader_cache, reader);
+        
+        mutex_lock(&devices_mutex);
+        dev->open_count--;
+        mutex_unlock(&devices_mutex);
+    }
+    
+    dbg_dev_info(2, minor, "Device closed\n");
+    return 0;
+}
+
+// consume len bytes of the iterator as one frame of '0'/'1' digits, channels
+// without a digit are 0; returns the number of digits or -EFAULT. Only the
+// bytes up to the last channel are copied, the rest of the frame is skipped.
+static int parse_frame(struct iov_iter *from, size_t len, char *states)
+{
+    char chunk[64];
+    size_t n;
+    int valid_digits = 0;
+    
+    memset(states, '0', NUM_CHANNELS);
+    
+    while (len > 0 && valid_digits < NUM_CHANNELS) {
+        n = min(len, sizeof(chunk));
+        if (copy_from_iter(chunk, n, from) != n) {
+            return -EFAULT;
+        }
+        len -= n;
+        
+        valid_digits = dsim_parse_digits(chunk, n, states, NULL, valid_digits, NUM_CHANNELS);
+    }
+    iov_iter_advance(from, len);
+    return valid_digits;
+}
+
+// one state per frame: the first read waits for a change, the buffer is
+// then filled with changes that are already pending
+static ssize_t device_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct file *filep = iocb->ki_filp;
+    struct iohubx24_reader *reader = filep->private_data;
+    struct iohubx24_device *dev;
+    union {
+        char message[BUFFER_SIZE];
+        struct iohubx24_record record;
+    } frame;
+    wait_queue_head_t *wq;
+    size_t frame_size;
+    bool binary;
+    u64 woken_ns = 0;
+    u64 generation;
+    ssize_t total = 0;
+    
+    if (!reader || !reader->device) {
+        dbg_err("Invalid reader or device pointer\n");
+        return -EFAULT;
+    }
+    dev = reader->device;
+    
+    binary = READ_ONCE(reader->read_mode) == IOHUBX24_READ_RECORD;
+    frame_size = binary ? sizeof(frame.record) : BUFFER_SIZE;
+    if (iov_iter_count(to) < frame_size) {
+        return -EINVAL;
+    }
+    
+    // wait for state change if needed (for blocking reads)
+    if (!reader_has_data(reader)) {
+        if ((filep->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+            this_cpu_inc(dev->stats->eagain);
+            return -EAGAIN;
+        }
+        // the queue is chosen once, a mask set meanwhile wakes both
+        wq = reader_wait(reader);
+        if (wait_event_interruptible(*wq, reader_has_data(reader))) {
+            return -ERESTARTSYS;
+        }
+        woken_ns = ktime_get_ns();
+    }
+    
+    while (iov_iter_count(to) >= frame_size && reader_has_data(reader)) {
+        mutex_lock(&dev->state_mutex);
+        
+        if (woken_ns) {
+            account_wakeup_latency(dev, woken_ns);
+            woken_ns = 0;
+        }
+        
+        // the generation only moves under state_mutex, so it matches the copy
+        generation = dsim_generation(&dev->notify);
+        // a masked reader skips the changes filtered out by its mask, the
+        // ones it missed are counted by commit_channel_states()
+        if (!reader->masked && generation - reader->seen_generation > 1) {
+            this_cpu_add(dev->stats->conflated, generation - reader->seen_generation - 1);
+        }
+        reader->seen_generation = generation;
+        
+        if (binary) {
+            frame.record.timestamp_ns = dev->state_page->last_change_ns;
+            frame.record.seq = reader->seen_generation;
+            frame.record.state = channel_states_to_bits(dev->channel_states);
+            frame.record.reserved = 0;
+        } else {
+            // copy channel states and add newline
+            memcpy(frame.message, dev->channel_states, NUM_CHANNELS);
+            frame.message[NUM_CHANNELS] = '\n';
+        }
+        dbg_dev_info(3, dev->minor, "Read channel states: %.24s\n", dev->channel_states);
+        
+        mutex_unlock(&dev->state_mutex);
+        
+        if (copy_to_iter(&frame, frame_size, to) != frame_size) {
+            dbg_dev_info(2, dev->minor, "Failed to send channel states to user\n");
+            return total ? total : -EFAULT;
+        }
+        total += frame_size;
+    }
+    
+    this_cpu_inc(dev->stats->reads);
+    this_cpu_add(dev->stats->bytes_out, total);
+    if (total > 0 && trace_iohubx24_sim_read_enabled()) {
+        trace_iohubx24_sim_read(dev->minor, binary ? frame.record.state : channel_states_to_bits(frame.message),
+                                total);
+    }
+    return total;
+}
+
+// each iovec segment is an independent update, so one writev() or a batch
+// of io_uring writes applies several frames with a single wakeup
+static ssize_t device_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+    struct iohubx24_reader *writer_reader = iocb->ki_filp->private_data;
+    struct iohubx24_device *dev = writer_reader->device;
+    char states[NUM_CHANNELS];
+    size_t len = iov_iter_count(from);
+    int valid_digits;
+    int changed = 0;
+    
+    if (!dev) {
+        dbg_err("Invalid device pointer\n");
+        return -EFAULT;
+    }
+    
+    if (len == 0) {
+        return 0;
+    }
+    
+    while (iov_iter_count(from) > 0) {
+        size_t done = len - iov_iter_count(from);
+        
+        valid_digits = parse_frame(from, iter_segment_len(from), states);
+        if (valid_digits < 0) {
+            len = done;
+            break;
+        }
+        
+        mutex_lock(&dev->state_mutex);
+        
+        // save previous states
+        memcpy(dev->prev_channel_states, dev->channel_states, NUM_CHANNELS);
+        memcpy(dev->channel_states, states, NUM_CHANNELS);
+        changed |= commit_channel_states(dev);
+        
+        mutex_unlock(&dev->state_mutex);
+        
+        if (trace_iohubx24_sim_write_enabled()) {
+            trace_iohubx24_sim_write(dev->minor, channel_states_to_bits(states),
+                                     len - iov_iter_count(from) - done);
+        }
+        dbg_dev_info(2, dev->minor, "Updated channel states: %.24s (from %d valid digits)\n",
+                     states, valid_digits);
+    }
+    
+    // If state changed, wake up all waiting readers
+    if (changed) {
+        wake_readers(dev);
+    }
+    
+    this_cpu_inc(dev->stats->writes);
+    this_cpu_add(dev->stats->bytes_in, len);
+    return len ? len : -EFAULT;
+}
+
+static unsigned int device_poll(struct file *filep, struct poll_table_struct *wait)
+{
+    struct iohubx24_reader *reader = filep->private_data;
+    unsigned int mask = 0;
+
+    if (!reader || !reader->device) {
+        return POLLERR;
+    }
+
+    // a masked reader is only woken on its own waitqueue, which is polled
+    // in any case so that a mask set after the file was added to epoll
+    // still reports the changes
+    poll_wait(filep, &reader->wait, wait);
+    if (!READ_ONCE(reader->masked)) {
+        poll_wait(filep, &reader->device->notify.wait, wait);
+    }
+
+    if (reader_has_data(reader)) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+
+    return mask;
+}
+
+static int device_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+    struct iohubx24_reader *reader = filep->private_data;
+    struct iohubx24_device *dev;
+
+    if (!reader || !reader->device) {
+        return -EFAULT;
+    }
+    dev = reader->device;
+
+    // single read-only page, offset 0
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE) {
+        return -EINVAL;
+    }
+    if (vma->vm_flags & VM_WRITE) {
+        return -EPERM;
+    }
+    VM_FLAGS_CLEAR_COMPAT(vma, VM_MAYWRITE);
+
+    dbg_dev_info(2, dev->minor, "State page mapped\n");
+    return remap_pfn_range(vma, vma->vm_start, virt_to_phys(dev->state_page) >> PAGE_SHIFT,
+                           PAGE_SIZE, vma->vm_page_prot);
+}
+
+// the reader moves to the masked list for good, a mask of all channels
+// only brings back the wakeup on every change; the next read returns the
+// current state, and a read sleeping on the device waitqueue returns it
+static int reader_set_mask(struct iohubx24_reader *reader, unsigned long mask)
+{
+    struct iohubx24_device *dev = reader->device;
+    u64 generation;
+
+    if (mask == 0 || (mask & ~CHANNELS_MASK)) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&dev->state_mutex);
+    reader->mask = mask;
+    generation = dsim_generation(&dev->notify);
+    WRITE_ONCE(reader->wanted_generation, generation);
+    WRITE_ONCE(reader->seen_generation, generation - 1);
+    if (!reader->masked) {
+        list_add(&reader->masked_list, &dev->masked_readers_list);
+        WRITE_ONCE(reader->masked, true);
+    }
+    mutex_unlock(&dev->state_mutex);
+
+    wake_up_interruptible(&reader->wait);
+    wake_up_interruptible(&dev->notify.wait);
+
+    dbg_dev_info(2, dev->minor, "Channel mask set to %06lx\n", mask);
+    return 0;
+}
+
+static long device_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
+{
+    struct iohubx24_reader *reader = filep->private_data;
+    struct iohubx24_device *dev;
+    struct iohubx24_bits bits;
+    u32 old, new;
+    int changed;
+
+    if (!reader || !reader->device) {
+        return -EFAULT;
+    }
+    dev = reader->device;
+
+    switch (cmd) {
+    case IOHUBX24_IOC_SET_READ_MODE:
+        if (arg != IOHUBX24_READ_TEXT && arg != IOHUBX24_READ_RECORD) {
+            return -EINVAL;
+        }
+        WRITE_ONCE(reader->read_mode, arg);
+        dbg_dev_info(2, dev->minor, "Read mode set to %lu\n", arg);
+        return 0;
+    case IOHUBX24_IOC_SET_MASK:
+        return reader_set_mask(reader, arg);
+    case IOHUBX24_IOC_SET_BITS:
+    case IOHUBX24_IOC_CLEAR_BITS:
+    case IOHUBX24_IOC_TOGGLE_BITS:
+    case IOHUBX24_IOC_SWAP:
+        break;
+    default:
+        return -ENOTTY;
+    }
+
+    if (copy_from_user(&bits, (void __user *)arg, sizeof(bits))) {
+        return -EFAULT;
+    }
+    if ((bits.mask & ~CHANNELS_MASK) ||
+        (cmd == IOHUBX24_IOC_SWAP && (bits.value & ~CHANNELS_MASK))) {
+        return -EINVAL;
+    }
+
+    // read-modify-write of all channels as one update
+    mutex_lock(&dev->state_mutex);
+
+    memcpy(dev->prev_channel_states, dev->channel_states, NUM_CHANNELS);
+    old = channel_states_to_bits(dev->channel_states);
+
+    switch (cmd) {
+    case IOHUBX24_IOC_SET_BITS:
+        new = old | bits.mask;
+        break;
+    case IOHUBX24_IOC_CLEAR_BITS:
+        new = old & ~bits.mask;
+        break;
+    case IOHUBX24_IOC_TOGGLE_BITS:
+        new = old ^ bits.mask;
+        break;
+    default:
+        new = (old & ~bits.mask) | (bits.value & bits.mask);
+        break;
+    }
+
+    bits_to_channel_states(dev->channel_states, new);
+    changed = commit_channel_states(dev);
+
+    mutex_unlock(&dev->state_mutex);
+
+    this_cpu_inc(dev->stats->writes);
+
+    if (changed) {
+        wake_readers(dev);
+    }
+
+    dbg_dev_info(2, dev->minor, "ioctl 0x%x: %06x -> %06x\n", cmd, old, new);
+
+    if (cmd == IOHUBX24_IOC_SWAP) {
+        bits.value = old;
+        if (copy_to_user((void __user *)arg, &bits, sizeof(bits))) {
+            return -EFAULT;
+        }
+    }
+    return 0;
+}
+
+// current channel states, for plc-sim
+int iohubx24_sim_get_channels(int minor, u32 *state)
+{
+    struct iohubx24_device *dev;
+
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        mutex_lock(&dev->state_mutex);
+        *state = channel_states_to_bits(dev->channel_states);
+        mutex_unlock(&dev->state_mutex);
+    }
+    mutex_unlock(&devices_mutex);
+    return dev ? 0 : -ENODEV;
+}
+EXPORT_SYMBOL_GPL(iohubx24_sim_get_channels);
+
+// set the channels in mask to value as one update, like IOHUBX24_IOC_SWAP;
+// used by plc-sim to drive the channels
+int iohubx24_sim_set_channels(int minor, u32 mask, u32 value)
+{
+    struct iohubx24_device *dev;
+    u32 old;
+    int changed;
+
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (!dev) {
+        mutex_unlock(&devices_mutex);
+        return -ENODEV;
+    }
+
+    mutex_lock(&dev->state_mutex);
+    memcpy(dev->prev_channel_states, dev->channel_states, NUM_CHANNELS);
+    old = channel_states_to_bits(dev->channel_states);
+    bits_to_channel_states(dev->channel_states, (old & ~mask) | (value & mask & CHANNELS_MASK));
+    changed = commit_channel_states(dev);
+    mutex_unlock(&dev->state_mutex);
+
+    this_cpu_inc(dev->stats->writes);
+    if (changed) {
+        wake_readers(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    return 0;
+}
+EXPORT_SYMBOL_GPL(iohubx24_sim_set_channels);
+
+// set by ihubx24-sim when it or this module is loaded, cleared when it unloads
+void iohubx24_sim_set_wire_hook(dsim_wire_fn fn)
+{
+    rcu_assign_pointer(wire_hook, fn);
+}
+EXPORT_SYMBOL_GPL(iohubx24_sim_set_wire_hook);
+
+static int all_open(struct inode *inodep, struct file *filep)
+{
+    struct iohubx24_reader *reader;
+
+    reader = kmem_cache_alloc(reader_cache, GFP_KERNEL);
+    if (!reader) {
+        return -ENOMEM;
+    }
+
+    atomic_inc(&fleet.readers);
+    reader->device = NULL;
+    // the first read returns the current states
+    reader->seen_generation = dsim_generation(&fleet.notify) - 1;
+
+    filep->private_data = reader;
+    dbg_info(2, "Aggregate file opened\n");
+    return 0;
+}
+
+static int all_release(struct inode *inodep, struct file *filep)
+{
+    kmem_cache_free(reader_cache, filep->private_data);
+    atomic_dec(&fleet.readers);
+    dbg_info(2, "Aggregate file closed\n");
+    return 0;
+}
+
+// channel states and change number of a device from its state page,
+// without taking state_mutex
+static void read_state_page(struct iohubx24_device *dev, struct iohubx24_snapshot *entry)
+{
+    struct iohubx24_state_page *page = dev->state_page;
+    u32 seq;
+
+    do {
+        seq = READ_ONCE(page->seq);
+        smp_rmb();
+        entry->seq = page->generation;
+        entry->state = channel_states_to_bits(page->channel_states);
+        smp_rmb();
+    } while ((seq & 1) || READ_ONCE(page->seq) != seq);
+    entry->minor = dev->minor;
+}
+
+// one struct iohubx24_snapshot per device in minor order, as many as fit in
+// the buffer; waits for a change since the last read like the device files
+static ssize_t all_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct file *filep = iocb->ki_filp;
+    struct iohubx24_reader *reader = filep->private_data;
+    struct iohubx24_snapshot *entries;
+    struct iohubx24_device *dev;
+    size_t max_entries = min_t(size_t, iov_iter_count(to) / sizeof(*entries), MAX_DEVICES);
+    size_t n = 0, size;
+    u64 generation = 0;
+    int id, pass;
+
+    if (max_entries == 0) {
+        return -EINVAL;
+    }
+
+    if (!dsim_pending(&fleet.notify, reader->seen_generation)) {
+        if ((filep->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT)) {
+            return -EAGAIN;
+        }
+        if (wait_event_interruptible(fleet.notify.wait, dsim_pending(&fleet.notify, reader->seen_generation))) {
+            return -ERESTARTSYS;
+        }
+    }
+
+    entries = kvmalloc_array(max_entries, sizeof(*entries), GFP_KERNEL);
+    if (!entries) {
+        return -ENOMEM;
+    }
+
+    // devices_mutex keeps the table still, the pass is repeated while a
+    // device published a change during it so that the entries are of one
+    // instant; past SNAPSHOT_PASSES the last pass is returned and the
+    // reader stays pending
+    mutex_lock(&devices_mutex);
+    for (pass = 0; pass < SNAPSHOT_PASSES; pass++) {
+        generation = dsim_generation(&fleet.notify);
+        n = 0;
+        idr_for_each_entry(&devices_idr, dev, id) {
+            if (n == max_entries) {
+                break;
+            }
+            read_state_page(dev, &entries[n++]);
+        }
+        smp_rmb();
+        if (dsim_generation(&fleet.notify) == generation) {
+            break;
+        }
+    }
+    mutex_unlock(&devices_mutex);
+    WRITE_ONCE(reader->seen_generation, generation);
+
+    size = n * sizeof(*entries);
+    if (copy_to_iter(entries, size, to) != size) {
+        kvfree(entries);
+        return -EFAULT;
+    }
+    kvfree(entries);
+
+    dbg_info(3, "Snapshot of %zu device(s) in %d pass(es)\n", n, pass + 1);
+    return size;
+}
+
+static unsigned int all_poll(struct file *filep, struct poll_table_struct *wait)
+{
+    struct iohubx24_reader *reader = filep->private_data;
+
+    poll_wait(filep, &fleet.notify.wait, wait);
+
+    if (dsim_pending(&fleet.notify, READ_ONCE(reader->seen_generation))) {
+        return POLLIN | POLLRDNORM;
+    }
+    return 0;
+}
+
+static int latency_hist_show(struct seq_file *m, void *v)
+{
+    struct iohubx24_device *dev = m->private;
+    u64 count;
+    int i;
+
+    seq_puts(m, "latency_ns count\n");
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        count = atomic64_read(&dev->latency_hist[i]);
+        if (i == LATENCY_BUCKETS - 1) {
+            seq_printf(m, "%llu-inf %llu\n", 1ULL << i, count);
+        } else {
+            seq_printf(m, "%llu-%llu %llu\n", i ? 1ULL << i : 0, (2ULL << i) - 1, count);
+        }
+    }
+    return 0;
+}
+
+static int latency_hist_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, latency_hist_show, inode->i_private);
+}
+
+// any write clears the histogram
+static ssize_t latency_hist_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct iohubx24_device *dev = ((struct seq_file *)file->private_data)->private;
+    int i;
+
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        atomic64_set(&dev->latency_hist[i], 0);
+    }
+    dbg_dev_info(2, dev->minor, "Latency histogram reset\n");
+    return count;
+}
+
+static const struct file_operations latency_hist_fops = {
+    .owner = THIS_MODULE,
+    .open = latency_hist_open,
+    .read = seq_read,
+    .write = latency_hist_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct iohubx24_device *dev;
+    int result;
+    
+    dev = kzalloc(sizeof(struct iohubx24_device), GFP_KERNEL);
+    if (!dev) {
+        return -ENOMEM;
+    }
+    
+    dev->stats = alloc_percpu(struct iohubx24_stats);
+    if (!dev->stats) {
+        kfree(dev);
+        return -ENOMEM;
+    }
+    
+    dev->state_page = (struct iohubx24_state_page *)get_zeroed_page(GFP_KERNEL);
+    if (!dev->state_page) {
+        dbg_err("Failed to allocate state page for device %d\n", id);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return -ENOMEM;
+    }
+    memset(dev->state_page->channel_states, '0', NUM_CHANNELS);
+    // the initial state counts as the change at creation time
+    dev->state_page->last_change_ns = ktime_get_ns();
+    
+    result = idr_alloc(&devices_idr, dev, id, id + 1, GFP_KERNEL);
+    if (result < 0) {
+        free_page((unsigned long)dev->state_page);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return result == -ENOSPC ? -EEXIST : result;
+    }
+    
+    dev->dev_num = MKDEV(major_number, id);
+    dev->minor = id;
+    mutex_init(&dev->state_mutex);
+    dsim_notifier_init(&dev->notify);
+    INIT_LIST_HEAD(&dev->masked_readers_list);
+    
+    memset(dev->channel_states, '0', NUM_CHANNELS);
+    memset(dev->prev_channel_states, '0', NUM_CHANNELS);
+    
+    dev->device = device_create(iohubx24_class, NULL, dev->dev_num, dev, DEVICE_NAME "%d", id);
+    if (IS_ERR(dev->device)) {
+        dbg_err("Failed to create device %d\n", id);
+        result = PTR_ERR(dev->device);
+        goto cleanup_dev;
+    }
+    
+    result = sysfs_create_group(&dev->device->kobj, &iohubx24_stats_group);
+    if (result) {
+        dbg_err("Failed to create sysfs attributes for device %d\n", id);
+        device_destroy(iohubx24_class, dev->dev_num);
+        goto cleanup_dev;
+    }
+    
+    // debugfs is optional, failures are not fatal
+    dev->debugfs_dir = debugfs_create_dir(dev_name(dev->device), iohubx24_debugfs_root);
+    debugfs_create_file("latency_hist", 0644, dev->debugfs_dir, dev, &latency_hist_fops);
+    
+    // a new device changes the snapshot of the aggregate file
+    dsim_fleet_publish(&fleet);
+    dsim_fleet_wake(&fleet);
+    
+    dbg_dev_info(1, id, "Device created correctly\n");
+    dbg_dev_info(2, id, "Initial channel states: %.24s\n", dev->channel_states);
+    return 0;
+    
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&dev->state_mutex);
+    free_page((unsigned long)dev->state_page);
+    free_percpu(dev->stats);
+    kfree(dev);
+    return result;
+}
+
+// caller holds devices_mutex, the device must not be open
+static void destroy_device(struct iohubx24_device *dev)
+{
+    int id = dev->minor;
+    
+    // waits for debugfs readers of this device to return
+    debugfs_remove_recursive(dev->debugfs_dir);
+    sysfs_remove_group(&dev->device->kobj, &iohubx24_stats_group);
+    device_destroy(iohubx24_class, dev->dev_num);
+    free_page((unsigned long)dev->state_page);
+    free_percpu(dev->stats);
+    mutex_destroy(&dev->state_mutex);
+    idr_remove(&devices_idr, id);
+    kfree(dev);
+    dsim_fleet_publish(&fleet);
+    dsim_fleet_wake(&fleet);
+    
+    dbg_dev_info(1, id, "Device removed\n");
+}
+
+static void destroy_all_devices(void)
+{
+    struct iohubx24_device *dev;
+    int id;
+    
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, dev, id) {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/iohubx24/new_device creates /dev/iohubx24-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+    
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+// echo N > /sys/class/iohubx24/delete_device removes /dev/iohubx24-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct iohubx24_device *dev;
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, id);
+    if (!dev) {
+        ret = -ENODEV;
+    } else if (dev->open_count) {
+        ret = -EBUSY;
+    } else {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
+static int __init iohubx24_init(void)
+{
+    dev_t dev_num;
+    int i, result;
+    
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
+        dbg_err("Invalid num_devices (%d). Must be 0-%d\n", num_devices, MAX_DEVICES);
+        return -EINVAL;
+    }
+    
+    dbg_info(1, "Initializing %d iohubx24-sim device(s)\n", num_devices);
+    
+    dsim_fleet_init(&fleet);
+    
+    // minors are reserved for every possible device and the aggregate file
+    result = alloc_chrdev_region(&dev_num, 0, NUM_MINORS, DEVICE_NAME);
+    if (result < 0) {
+        dbg_err("Failed to allocate major number\n");
+        return result;
+    }
+    major_number = MAJOR(dev_num);
+    dbg_info(1, "Registered correctly with major number %d\n", major_number);
+    
+    // one cdev covers the whole minor range, open() looks the device up
+    cdev_init(&iohubx24_cdev, &fops);
+    iohubx24_cdev.owner = THIS_MODULE;
+    result = cdev_add(&iohubx24_cdev, dev_num, MAX_DEVICES);
+    if (result) {
+        dbg_err("Failed to add cdev\n");
+        unregister_chrdev_region(dev_num, NUM_MINORS);
+        return result;
+    }
+    
+    iohubx24_class = CLASS_CREATE_COMPAT(CLASS_NAME);
+    if (IS_ERR(iohubx24_class)) {
+        cdev_del(&iohubx24_cdev);
+        unregister_chrdev_region(dev_num, NUM_MINORS);
+        dbg_err("Failed to create device class\n");
+        return PTR_ERR(iohubx24_class);
+    }
+    dbg_info(1, "Device class created correctly\n");
+    
+    iohubx24_debugfs_root = debugfs_create_dir(DEVICE_NAME, NULL);
+    
+    reader_cache = KMEM_CACHE(iohubx24_reader, 0);
+    if (!reader_cache) {
+        result = -ENOMEM;
+        goto cleanup_devices;
+    }
+    
+    event_bus = dsim_events_register("iohubx24_sim", DSIM_EVENTS_IOHUBX24);
+    if (IS_ERR(event_bus)) {
+        result = PTR_ERR(event_bus);
+        dbg_err("Failed to register the events family\n");
+        goto cleanup_devices;
+    }
+    
+    // create the initial devices, more can be added through new_device
+    result = 0;
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices && !result; i++) {
+        result = create_device(i);
+    }
+    mutex_unlock(&devices_mutex);
+    if (result) {
+        goto cleanup_devices;
+    }
+    
+    // /dev/iohubx24-sim-all, a snapshot of all the devices
+    cdev_init(&iohubx24_all_cdev, &all_fops);
+    iohubx24_all_cdev.owner = THIS_MODULE;
+    result = cdev_add(&iohubx24_all_cdev, MKDEV(major_number, ALL_MINOR), 1);
+    if (result) {
+        goto cleanup_devices;
+    }
+    all_device = device_create(iohubx24_class, NULL, MKDEV(major_number, ALL_MINOR), NULL, DEVICE_NAME "-all");
+    if (IS_ERR(all_device)) {
+        dbg_err("Failed to create the aggregate device\n");
+        result = PTR_ERR(all_device);
+        cdev_del(&iohubx24_all_cdev);
+        goto cleanup_devices;
+    }
+    
+    result = class_create_file(iohubx24_class, &class_attr_new_device);
+    if (result) {
+        goto cleanup_all;
+    }
+    result = class_create_file(iohubx24_class, &class_attr_delete_device);
+    if (result) {
+        class_remove_file(iohubx24_class, &class_attr_new_device);
+        goto cleanup_all;
+    }
+    
+    dbg_info(1, "Module loaded successfully\n");
+    return 0;
+    
+cleanup_all:
+    device_destroy(iohubx24_class, MKDEV(major_number, ALL_MINOR));
+    cdev_del(&iohubx24_all_cdev);
+cleanup_devices:
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    debugfs_remove_recursive(iohubx24_debugfs_root);
+    kmem_cache_destroy(reader_cache);
+    class_destroy(iohubx24_class);
+    cdev_del(&iohubx24_cdev);
+    unregister_chrdev_region(dev_num, NUM_MINORS);
+    return result;
+}
+
+static void __dsim_exit iohubx24_exit(void)
+{
+    dbg_info(1, "Unloading module\n");
+    
+    class_remove_file(iohubx24_class, &class_attr_delete_device);
+    class_remove_file(iohubx24_class, &class_attr_new_device);
+    
+    device_destroy(iohubx24_class, MKDEV(major_number, ALL_MINOR));
+    cdev_del(&iohubx24_all_cdev);
+    
+    // no file can be open here, the module is pinned while one is
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    debugfs_remove_recursive(iohubx24_debugfs_root);
+    kmem_cache_destroy(reader_cache);
+    
+    if (iohubx24_class) {
+        class_destroy(iohubx24_class);
+    }
+    
+    cdev_del(&iohubx24_cdev);
+    unregister_chrdev_region(MKDEV(major_number, 0), NUM_MINORS);
+    
+    dbg_info(1, "Module unloaded successfully\n");
+}
+
+DSIM_MODULE(iohub, iohubx24_init, iohubx24_exit)
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("DOMIoT");
+MODULE_DESCRIPTION("I/O Hub x24 digital channels module for simulation");
+MODULE_VERSION("1.0.0"); 
\ No newline at end of file
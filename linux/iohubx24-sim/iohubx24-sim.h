@@ -0,0 +1,61 @@
+#ifndef _IOHUBX24_SIM_H
+#define _IOHUBX24_SIM_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define IOHUBX24_NUM_CHANNELS 24
+
+// read-only page exposed by mmap() on /dev/iohubx24-sim*
+// seq is odd while the kernel updates the page: read seq, copy the fields,
+// read seq again and retry if it was odd or has changed
+struct iohubx24_state_page {
+    __u32 seq;
+    __u32 reserved;
+    __u64 generation;       // incremented on every state change
+    __u64 last_change_ns;   // CLOCK_MONOTONIC time of the last change
+    char channel_states[IOHUBX24_NUM_CHANNELS];
+};
+
+// argument of the bit ioctls, bit n = channel n
+// SET/CLEAR/TOGGLE apply to the channels in mask and ignore value
+// SWAP sets the channels in mask to value and returns the previous state of
+// all channels in value
+struct iohubx24_bits {
+    __u32 mask;
+    __u32 value;
+};
+
+// record returned by read() in IOHUBX24_READ_RECORD mode
+struct iohubx24_record {
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC time of the change
+    __u64 seq;              // change number, a gap means changes were missed
+    __u32 state;            // bit n = channel n
+    __u32 reserved;
+};
+
+// entry returned by read() on /dev/iohubx24-sim-all, one per device in
+// minor order
+struct iohubx24_snapshot {
+    __u32 minor;
+    __u32 state;            // bit n = channel n
+    __u64 seq;              // change number of the device, as in struct iohubx24_record
+};
+
+// read modes, selected per open file with IOHUBX24_IOC_SET_READ_MODE
+#define IOHUBX24_READ_TEXT   0  // 24 digits and a newline (default)
+#define IOHUBX24_READ_RECORD 1  // struct iohubx24_record
+
+#define IOHUBX24_IOC_MAGIC 'h'
+
+#define IOHUBX24_IOC_SET_BITS    _IOW(IOHUBX24_IOC_MAGIC, 1, struct iohubx24_bits)
+#define IOHUBX24_IOC_CLEAR_BITS  _IOW(IOHUBX24_IOC_MAGIC, 2, struct iohubx24_bits)
+#define IOHUBX24_IOC_TOGGLE_BITS _IOW(IOHUBX24_IOC_MAGIC, 3, struct iohubx24_bits)
+#define IOHUBX24_IOC_SWAP        _IOWR(IOHUBX24_IOC_MAGIC, 4, struct iohubx24_bits)
+// the mode is passed by value
+#define IOHUBX24_IOC_SET_READ_MODE _IO(IOHUBX24_IOC_MAGIC, 5)
+// the channels a reader is woken for, bit n = channel n, passed by value;
+// the default is all of them
+#define IOHUBX24_IOC_SET_MASK _IO(IOHUBX24_IOC_MAGIC, 6)
+
+#endif
@@ -0,0 +1,100 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM iohubx24_sim
+
+#if !defined(_IOHUBX24_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _IOHUBX24_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(iohubx24_sim_file,
+    TP_PROTO(int minor),
+    TP_ARGS(minor),
+    TP_STRUCT__entry(
+        __field(int, minor)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+    ),
+    TP_printk("minor=%d", __entry->minor)
+);
+
+DEFINE_EVENT(iohubx24_sim_file, iohubx24_sim_open,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+DEFINE_EVENT(iohubx24_sim_file, iohubx24_sim_release,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+// state is the last state read or written, bytes the length of the call
+DECLARE_EVENT_CLASS(iohubx24_sim_io,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, state)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d state=%06x bytes=%zu", __entry->minor, __entry->state, __entry->bytes)
+);
+
+DEFINE_EVENT(iohubx24_sim_io, iohubx24_sim_read,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes)
+);
+
+DEFINE_EVENT(iohubx24_sim_io, iohubx24_sim_write,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes)
+);
+
+TRACE_EVENT(iohubx24_sim_state_change,
+    TP_PROTO(int minor, u32 old_state, u32 new_state, u64 generation),
+    TP_ARGS(minor, old_state, new_state, generation),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, old_state)
+        __field(u32, new_state)
+        __field(u64, generation)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->old_state = old_state;
+        __entry->new_state = new_state;
+        __entry->generation = generation;
+    ),
+    TP_printk("minor=%d state=%06x->%06x generation=%llu", __entry->minor,
+              __entry->old_state, __entry->new_state, __entry->generation)
+);
+
+// a blocked reader returned from its wait, latency since the last commit
+TRACE_EVENT(iohubx24_sim_wakeup,
+    TP_PROTO(int minor, u64 generation, u64 latency_ns),
+    TP_ARGS(minor, generation, latency_ns),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u64, generation)
+        __field(u64, latency_ns)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->generation = generation;
+        __entry->latency_ns = latency_ns;
+    ),
+    TP_printk("minor=%d generation=%llu latency_ns=%llu", __entry->minor,
+              __entry->generation, __entry->latency_ns)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
@@ -0,0 +1,328 @@
+#include <kunit/test.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/string.h>
+#include <linux/limits.h>
+
+#include "domiot-sim-text.h"
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("DOMIoT");
+MODULE_DESCRIPTION("KUnit tests of the simulators' parsers and log formatters");
+
+// iterations of the timing cases, enough to get past timer resolution
+#define BENCH_ITERATIONS 100000
+
+// --- dsim_parse_digits ---
+
+static void parse_digits_empty(struct kunit *test)
+{
+    char states[24];
+    u32 bits = 0;
+
+    memset(states, 'x', sizeof(states));
+    KUNIT_EXPECT_EQ(test, dsim_parse_digits("", 0, states, &bits, 0, 24), 0);
+    KUNIT_EXPECT_EQ(test, bits, 0U);
+    KUNIT_EXPECT_EQ(test, states[0], 'x');
+}
+
+static void parse_digits_bits(struct kunit *test)
+{
+    char states[24];
+    u32 bits = 0;
+
+    KUNIT_EXPECT_EQ(test, dsim_parse_digits("1011", 4, states, &bits, 0, 24), 4);
+    KUNIT_EXPECT_EQ(test, bits, 0xdU);
+    KUNIT_EXPECT_EQ(test, memcmp(states, "1011", 4), 0);
+}
+
+static void parse_digits_non_digits(struct kunit *test)
+{
+    const char *in = "1 2\n0a1-x\r1";
+    char states[24];
+    u32 bits = 0;
+
+    KUNIT_EXPECT_EQ(test, dsim_parse_digits(in, strlen(in), states, &bits, 0, 24), 4);
+    KUNIT_EXPECT_EQ(test, memcmp(states, "1011", 4), 0);
+    KUNIT_EXPECT_EQ(test, bits, 0xdU);
+}
+
+static void parse_digits_overlong(struct kunit *test)
+{
+    char in[64];
+    char states[24];
+    u32 bits = 0;
+
+    memset(in, '1', sizeof(in));
+    KUNIT_EXPECT_EQ(test, dsim_parse_digits(in, sizeof(in), states, &bits, 0, 24), 24);
+    KUNIT_EXPECT_EQ(test, bits, 0xffffffU);
+}
+
+// a write split across chunks continues at pos, a full buffer takes nothing
+static void parse_digits_continues(struct kunit *test)
+{
+    char states[6];
+    int pos;
+
+    pos = dsim_parse_digits("010", 3, states, NULL, 0, 6);
+    pos = dsim_parse_digits("0101", 4, states, NULL, pos, 6);
+    KUNIT_EXPECT_EQ(test, pos, 6);
+    KUNIT_EXPECT_EQ(test, memcmp(states, "010010", 6), 0);
+    KUNIT_EXPECT_EQ(test, dsim_parse_digits("1", 1, states, NULL, pos, 6), 6);
+    KUNIT_EXPECT_EQ(test, states[5], '0');
+}
+
+// --- dsim_sanitize_text ---
+
+static void sanitize_text_empty(struct kunit *test)
+{
+    char out[8];
+
+    memset(out, 'x', sizeof(out));
+    KUNIT_EXPECT_EQ(test, dsim_sanitize_text("", 0, out, 7), 0);
+    KUNIT_EXPECT_STREQ(test, out, "");
+}
+
+static void sanitize_text_controls(struct kunit *test)
+{
+    const char in[] = "a\tb\nc\rd\x01\x7f\xe9z";
+    char out[32];
+
+    KUNIT_EXPECT_EQ(test, dsim_sanitize_text(in, sizeof(in) - 1, out, 31), 7);
+    KUNIT_EXPECT_STREQ(test, out, "ab c dz");
+}
+
+static void sanitize_text_overlong(struct kunit *test)
+{
+    char out[8];
+
+    memset(out, 'x', sizeof(out));
+    KUNIT_EXPECT_EQ(test, dsim_sanitize_text("hello world", 11, out, 5), 5);
+    KUNIT_EXPECT_STREQ(test, out, "hello");
+    KUNIT_EXPECT_EQ(test, out[6], 'x');
+}
+
+// --- dsim_parse_current_time ---
+
+static void parse_current_time_valid(struct kunit *test)
+{
+    unsigned long ms = 1;
+
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("0", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 0UL);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("20", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 20000UL);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("12.5", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 12500UL);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("1.12", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 1120UL);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("1.123", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 1123UL);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time("0.001", &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, 1UL);
+}
+
+static void parse_current_time_invalid(struct kunit *test)
+{
+    static const char * const bad[] = {
+        "", "12.", ".5", "1.2345", "abc", "1.a", "-1", "1.-5", "1 2",
+        "123456789012345678.5",
+    };
+    unsigned long ms = 42;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(bad); i++) {
+        KUNIT_EXPECT_EQ_MSG(test, dsim_parse_current_time(bad[i], &ms), -EINVAL,
+                            "\"%s\"", bad[i]);
+    }
+    KUNIT_EXPECT_EQ(test, ms, 42UL);
+}
+
+// the largest position that fits, and the first one that does not
+static void parse_current_time_boundary(struct kunit *test)
+{
+    char str[32];
+    unsigned long ms;
+
+    snprintf(str, sizeof(str), "%lu", ULONG_MAX / 1000);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time(str, &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, ULONG_MAX / 1000 * 1000);
+
+    snprintf(str, sizeof(str), "%lu.%03lu", ULONG_MAX / 1000, ULONG_MAX % 1000);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time(str, &ms), 0);
+    KUNIT_EXPECT_EQ(test, ms, ULONG_MAX);
+
+    snprintf(str, sizeof(str), "%lu", ULONG_MAX / 1000 + 1);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time(str, &ms), -EINVAL);
+
+    snprintf(str, sizeof(str), "%lu", ULONG_MAX);
+    KUNIT_EXPECT_EQ(test, dsim_parse_current_time(str, &ms), -EINVAL);
+}
+
+// --- log record formatters ---
+
+static void format_log_time(struct kunit *test)
+{
+    char buf[32];
+
+    KUNIT_EXPECT_EQ(test, dsim_format_log_time(buf, sizeof(buf), 0), 20);
+    KUNIT_EXPECT_STREQ(test, buf, "1970-01-01 00:00:00 ");
+    // 2038-01-19 03:14:08, one second past the 32-bit time_t limit
+    dsim_format_log_time(buf, sizeof(buf), 2147483648ULL * NSEC_PER_SEC + 999999999);
+    KUNIT_EXPECT_STREQ(test, buf, "2038-01-19 03:14:08 ");
+}
+
+static void format_outputs_record(struct kunit *test)
+{
+    char buf[64];
+    int len;
+
+    len = dsim_format_outputs_record(buf, sizeof(buf), 0, 0x800005, 24);
+    KUNIT_EXPECT_EQ(test, len, 20 + 24 + 1);
+    buf[len] = '\0';
+    KUNIT_EXPECT_STREQ(test, buf, "1970-01-01 00:00:00 101000000000000000000001\n");
+}
+
+static void format_outputs_record_truncated(struct kunit *test)
+{
+    char buf[32];
+    int len;
+
+    memset(buf, 'x', sizeof(buf));
+    KUNIT_EXPECT_EQ(test, dsim_format_outputs_record(buf, 0, 0, 0xffffff, 24), 0);
+    KUNIT_EXPECT_EQ(test, buf[0], 'x');
+
+    len = dsim_format_outputs_record(buf, 24, 0, 0xffffff, 24);
+    KUNIT_EXPECT_EQ(test, len, 23);
+    KUNIT_EXPECT_EQ(test, memcmp(buf + 20, "111", 3), 0);
+    KUNIT_EXPECT_EQ(test, buf[23], 'x');
+}
+
+static void format_text_record(struct kunit *test)
+{
+    char buf[64];
+
+    KUNIT_EXPECT_EQ(test, dsim_format_text_record(buf, sizeof(buf), 0, "hello world", 5), 26);
+    KUNIT_EXPECT_STREQ(test, buf, "1970-01-01 00:00:00 hello\n");
+    KUNIT_EXPECT_EQ(test, dsim_format_text_record(buf, sizeof(buf), 0, "", 0), 21);
+    KUNIT_EXPECT_STREQ(test, buf, "1970-01-01 00:00:00 \n");
+    KUNIT_EXPECT_EQ(test, dsim_format_text_record(buf, 24, 0, "hello", 5), 23);
+    KUNIT_EXPECT_STREQ(test, buf, "1970-01-01 00:00:00 hel");
+}
+
+// --- timing ---
+// Not pass/fail: each case reports the mean time per call of the routine,
+// so a change to the hot paths can be compared against the previous build.
+
+static void bench_report(struct kunit *test, const char *name, u64 start, int sink)
+{
+    u64 ns = ktime_get_ns() - start;
+
+    kunit_info(test, "%s: %llu ns/call (%d)\n", name,
+               div_u64(ns, BENCH_ITERATIONS), sink);
+}
+
+static void bench_parse_digits(struct kunit *test)
+{
+    const char *in = "101010101010101010101010\n";
+    char states[24];
+    u32 bits = 0;
+    int i, sink = 0;
+    u64 start = ktime_get_ns();
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += dsim_parse_digits(in, 25, states, &bits, 0, 24);
+    }
+    bench_report(test, "dsim_parse_digits", start, sink);
+}
+
+static void bench_sanitize_text(struct kunit *test)
+{
+    const char *in = "Temperature 21.5 C\nHumidity 40 %\r";
+    char out[64];
+    int i, sink = 0;
+    u64 start = ktime_get_ns();
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += dsim_sanitize_text(in, strlen(in), out, 63);
+    }
+    bench_report(test, "dsim_sanitize_text", start, sink);
+}
+
+static void bench_parse_current_time(struct kunit *test)
+{
+    unsigned long ms;
+    int i, sink = 0;
+    u64 start = ktime_get_ns();
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += dsim_parse_current_time("1234.567", &ms);
+    }
+    bench_report(test, "dsim_parse_current_time", start, sink);
+}
+
+static void bench_format_outputs_record(struct kunit *test)
+{
+    char buf[64];
+    int i, sink = 0;
+    u64 start = ktime_get_ns();
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += dsim_format_outputs_record(buf, sizeof(buf), (u64)i * NSEC_PER_SEC, i, 24);
+    }
+    bench_report(test, "dsim_format_outputs_record", start, sink);
+}
+
+static void bench_format_text_record(struct kunit *test)
+{
+    char buf[128];
+    int i, sink = 0;
+    u64 start = ktime_get_ns();
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += dsim_format_text_record(buf, sizeof(buf), (u64)i * NSEC_PER_SEC,
+                                        "Temperature 21.5 C", 18);
+    }
+    bench_report(test, "dsim_format_text_record", start, sink);
+}
+
+static struct kunit_case dsim_text_cases[] = {
+    KUNIT_CASE(parse_digits_empty),
+    KUNIT_CASE(parse_digits_bits),
+    KUNIT_CASE(parse_digits_non_digits),
+    KUNIT_CASE(parse_digits_overlong),
+    KUNIT_CASE(parse_digits_continues),
+    KUNIT_CASE(sanitize_text_empty),
+    KUNIT_CASE(sanitize_text_controls),
+    KUNIT_CASE(sanitize_text_overlong),
+    KUNIT_CASE(parse_current_time_valid),
+    KUNIT_CASE(parse_current_time_invalid),
+    KUNIT_CASE(parse_current_time_boundary),
+    KUNIT_CASE(format_log_time),
+    KUNIT_CASE(format_outputs_record),
+    KUNIT_CASE(format_outputs_record_truncated),
+    KUNIT_CASE(format_text_record),
+    {}
+};
+
+static struct kunit_case dsim_text_bench_cases[] = {
+    KUNIT_CASE(bench_parse_digits),
+    KUNIT_CASE(bench_sanitize_text),
+    KUNIT_CASE(bench_parse_current_time),
+    KUNIT_CASE(bench_format_outputs_record),
+    KUNIT_CASE(bench_format_text_record),
+    {}
+};
+
+static struct kunit_suite dsim_text_suite = {
+    .name = "domiot-sim-text",
+    .test_cases = dsim_text_cases,
+};
+
+static struct kunit_suite dsim_text_bench_suite = {
+    .name = "domiot-sim-text-bench",
+    .test_cases = dsim_text_bench_cases,
+};
+
+kunit_test_suites(&dsim_text_suite, &dsim_text_bench_suite);
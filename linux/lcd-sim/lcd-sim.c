@@ -13,56 +13,93 @@
 #include <linux/string.h>
 #include <linux/version.h>
 #include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/idr.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-text.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
 
 #define DEVICE_NAME "lcd-sim"
 #define CLASS_NAME "lcd"
-#define MAX_DEVICES 10
-#define MAX_LOG_ENTRIES 30
+#define MAX_DEVICES 1024
+#define DEFAULT_LOG_DEPTH 30
+#define MAX_LOG_DEPTH 100000
 #define LCD_MAX_CHARS 120
 #define LOG_ENTRY_SIZE 256
 
-// compatibility macros
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
-    #define CLASS_CREATE_COMPAT(name) class_create(name)
-#else
-    #define CLASS_CREATE_COMPAT(name) class_create(THIS_MODULE, name)
-#endif
-
 // debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
 static int debug_level = 1;
 module_param(debug_level, int, 0644);
 MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
 
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the lcd parameter of domiot-sim.ko
+extern int domiot_sim_lcd;
+#define num_devices domiot_sim_lcd
+#else
 static int num_devices = 1;
 module_param(num_devices, int, S_IRUGO);
-MODULE_PARM_DESC(num_devices, "Number of LCD devices to create (default: 1, max: 10)");
+MODULE_PARM_DESC(num_devices, "Number of LCD devices to create at load time (default: 1, max: 1024)");
+#endif
+
+static unsigned int flush_interval_ms = 100;
+module_param(flush_interval_ms, uint, 0644);
+MODULE_PARM_DESC(flush_interval_ms, "Delay before buffered log entries are written to the log file (default: 100)");
 
-// debug macros to reduce overhead
-#define dbg_err(fmt, ...) printk(KERN_ERR "lcd-sim: " fmt, ##__VA_ARGS__)
-#define dbg_info(level, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "lcd-sim: " fmt, ##__VA_ARGS__); } while(0)
-#define dbg_dev_info(level, dev_id, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "lcd-sim%d: " fmt, dev_id, ##__VA_ARGS__); } while(0)
+static unsigned int log_depth = DEFAULT_LOG_DEPTH;
+module_param(log_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(log_depth, "Initial number of log entries kept per device (default: 30, max: 100000)");
+
+// log entries are kept in binary form and only formatted when exported
+struct lcd_log_record {
+    u64 timestamp_ns;       // CLOCK_REALTIME
+    u8 len;
+    char text[LCD_MAX_CHARS];
+};
+
+// operation counters, per CPU so that concurrent writers never share a
+// cache line; the stats attributes sum them over all CPUs
+struct lcd_stats {
+    u64 writes;
+    u64 bytes_in;
+    u64 state_changes;  // display updates
+    u64 flushes;        // log file rewrites
+};
 
 struct lcd_device {
     dev_t dev_num;
-    struct cdev cdev;
     struct device *device;
     int minor;
+    // open files, delete_device is refused while non-zero
+    unsigned int open_count;
     char current_text[LCD_MAX_CHARS + 1];
-    char log_entries[MAX_LOG_ENTRIES][LOG_ENTRY_SIZE];
-    int log_count;
-    int log_head;
+    struct lcd_log_record *log_records;
+    unsigned int log_depth;
+    unsigned int log_count;
+    unsigned int log_head;
     struct mutex log_mutex;
+    struct delayed_work flush_work;
     struct mutex text_mutex;
+    struct lcd_stats __percpu *stats;
 };
 
 static int major_number;
 static struct class *lcd_class = NULL;
-static struct lcd_device *devices = NULL;
+static struct cdev lcd_cdev;
+// devices by minor, devices_mutex protects the table and open_count
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
 
 static int device_open(struct inode *, struct file *);
 static int device_release(struct inode *, struct file *);
 static ssize_t device_write(struct file *, const char *, size_t, loff_t *);
-static void add_log_entry(struct lcd_device *dev, const char *text);
+static void add_log_entry(struct lcd_device *dev, const char *text, int len);
 static void write_log_to_file(struct lcd_device *dev);
 
 static struct file_operations fops = {
@@ -71,15 +108,69 @@ static struct file_operations fops = {
     .release = device_release,
 };
 
+static ssize_t flush_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t log_depth_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t log_depth_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+
+static DEVICE_ATTR(flush, 0200, NULL, flush_store);
+static DEVICE_ATTR(log_depth, 0644, log_depth_show, log_depth_store);
+
+static struct attribute *lcd_attrs[] = {
+    &dev_attr_flush.attr,
+    &dev_attr_log_depth.attr,
+    NULL,
+};
+
+static const struct attribute_group lcd_attr_group = {
+    .attrs = lcd_attrs,
+};
+
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct lcd_device, struct lcd_stats, field)
+
+STATS_ATTR(writes);
+STATS_ATTR(bytes_in);
+STATS_ATTR(state_changes);
+STATS_ATTR(flushes);
+
+static struct attribute *lcd_stats_attrs[] = {
+    &dev_attr_stats_writes.attr,
+    &dev_attr_stats_bytes_in.attr,
+    &dev_attr_stats_state_changes.attr,
+    &dev_attr_stats_flushes.attr,
+    NULL,
+};
+
+// /sys/class/lcd/lcd-simN/stats/
+static const struct attribute_group lcd_stats_group = {
+    .name = "stats",
+    .attrs = lcd_stats_attrs,
+};
+
+static const struct attribute_group *lcd_attr_groups[] = {
+    &lcd_attr_group,
+    &lcd_stats_group,
+    NULL,
+};
+
 static int device_open(struct inode *inodep, struct file *filep)
 {
+    struct lcd_device *dev;
     int minor = iminor(inodep);
-    if (minor >= num_devices) {
+    
+    // keep the device from being deleted while it is open
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        dev->open_count++;
+    }
+    mutex_unlock(&devices_mutex);
+    if (!dev) {
         dbg_err("Invalid minor number %d\n", minor);
         return -ENODEV;
     }
     
-    filep->private_data = &devices[minor];
+    filep->private_data = dev;
+    trace_lcd_sim_open(minor);
     dbg_dev_info(2, minor, "LCD device opened\n");
     return 0;
 }
@@ -87,9 +178,10 @@ static int device_open(struct inode *inodep, struct file *filep)
 static ssize_t device_write(struct file *filep, const char *buffer, size_t len, loff_t *offset)
 {
     struct lcd_device *dev = (struct lcd_device *)filep->private_data;
-    char *user_input = NULL;
     char processed_text[LCD_MAX_CHARS + 1];
-    int i, processed_len = 0;
+    char chunk[64];
+    size_t done = 0, n;
+    int processed_len = 0;
     
     if (!dev) {
         dbg_err("Invalid device pointer\n");
@@ -100,43 +192,35 @@ static ssize_t device_write(struct file *filep, const char *buffer, size_t len,
         return 0;
     }
     
-    user_input = kmalloc(len + 1, GFP_KERNEL);
-    if (!user_input) {
-        dbg_err("Failed to allocate memory for user input\n");
-        return -ENOMEM;
-    }
-    
-    if (copy_from_user(user_input, buffer, len)) {
-        kfree(user_input);
-        return -EFAULT;
-    }
-    user_input[len] = '\0';
-    
-    // input text: take first 120 characters, convert newlines to spaces
-    memset(processed_text, 0, sizeof(processed_text));
-    for (i = 0; i < len && processed_len < LCD_MAX_CHARS; i++) {
-        if (user_input[i] == '\n' || user_input[i] == '\r') {
-            processed_text[processed_len] = ' ';
-            processed_len++;
-        } else if (user_input[i] >= 32 && user_input[i] <= 126) {
-            processed_text[processed_len] = user_input[i];
-            processed_len++;
+    // input text: take first 120 characters, convert newlines to spaces;
+    // copying stops once the display is full
+    processed_text[0] = '\0';
+    while (done < len && processed_len < LCD_MAX_CHARS) {
+        n = min(len - done, sizeof(chunk));
+        if (copy_from_user(chunk, buffer + done, n)) {
+            return -EFAULT;
         }
+        done += n;
+        processed_len += dsim_sanitize_text(chunk, n, processed_text + processed_len,
+                                            LCD_MAX_CHARS - processed_len);
     }
-    processed_text[processed_len] = '\0';
     
     mutex_lock(&dev->text_mutex);
     strncpy(dev->current_text, processed_text, LCD_MAX_CHARS);
     dev->current_text[LCD_MAX_CHARS] = '\0';
     mutex_unlock(&dev->text_mutex);
     
-    add_log_entry(dev, processed_text);
-    write_log_to_file(dev);
+    add_log_entry(dev, processed_text, processed_len);
+    this_cpu_inc(dev->stats->writes);
+    this_cpu_add(dev->stats->bytes_in, len);
+    this_cpu_inc(dev->stats->state_changes);
+    trace_lcd_sim_write(dev->minor, processed_len, len);
+    // the file is rewritten once per flush interval
+    schedule_delayed_work(&dev->flush_work, msecs_to_jiffies(flush_interval_ms));
     
     dbg_dev_info(2, dev->minor, "LCD updated with text: \"%s\" (%d chars)\n", 
                  processed_text, processed_len);
     
-    kfree(user_input);
     return len;
 }
 
@@ -144,176 +228,407 @@ static int device_release(struct inode *inodep, struct file *filep)
 {
     struct lcd_device *dev = (struct lcd_device *)filep->private_data;
     if (dev) {
+        mutex_lock(&devices_mutex);
+        dev->open_count--;
+        mutex_unlock(&devices_mutex);
+        trace_lcd_sim_release(dev->minor);
         dbg_dev_info(2, dev->minor, "LCD device closed\n");
     }
     return 0;
 }
 
-static void add_log_entry(struct lcd_device *dev, const char *text)
+static void add_log_entry(struct lcd_device *dev, const char *text, int len)
 {
-    struct timespec64 ts;
-    struct tm tm;
+    struct lcd_log_record *record;
     
     mutex_lock(&dev->log_mutex);
     
-    ktime_get_real_ts64(&ts);
-    time64_to_tm(ts.tv_sec, 0, &tm);
-    
-    // Format: "YYYY-MM-DD HH:MM:SS <text>"
-    snprintf(dev->log_entries[dev->log_head], LOG_ENTRY_SIZE,
-             "%04ld-%02d-%02d %02d:%02d:%02d %s",
-             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-             tm.tm_hour, tm.tm_min, tm.tm_sec, text);
+    record = &dev->log_records[dev->log_head];
+    record->timestamp_ns = ktime_get_real_ns();
+    record->len = len;
+    memcpy(record->text, text, len);
     
-    dev->log_head = (dev->log_head + 1) % MAX_LOG_ENTRIES;
-    if (dev->log_count < MAX_LOG_ENTRIES) {
+    dev->log_head = (dev->log_head + 1) % dev->log_depth;
+    if (dev->log_count < dev->log_depth) {
         dev->log_count++;
     }
     
     mutex_unlock(&dev->log_mutex);
 }
 
+// oldest-first copy of the newest max entries, caller holds log_mutex
+static unsigned int copy_log_records(struct lcd_device *dev, struct lcd_log_record *dst, unsigned int max)
+{
+    unsigned int n = min(dev->log_count, max);
+    unsigned int i;
+    
+    for (i = 0; i < n; i++) {
+        dst[i] = dev->log_records[(dev->log_head + dev->log_depth - n + i) % dev->log_depth];
+    }
+    return n;
+}
+
 static void write_log_to_file(struct lcd_device *dev)
 {
+    struct lcd_log_record *snapshot;
     struct file *file;
     char filename[32];
-    int i, idx;
+    char *buf;
+    size_t len = 0;
+    unsigned int count, depth;
+    int i;
     loff_t pos = 0;
     
+    depth = READ_ONCE(dev->log_depth);
+    snapshot = kvmalloc_array(depth, sizeof(*snapshot), GFP_KERNEL);
+    buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+    if (!snapshot || !buf) {
+        dbg_err("Failed to allocate log snapshot\n");
+        kvfree(snapshot);
+        kfree(buf);
+        return;
+    }
+    
+    // snapshot the binary records so writers are not blocked by formatting or file I/O
+    mutex_lock(&dev->log_mutex);
+    count = copy_log_records(dev, snapshot, depth);
+    mutex_unlock(&dev->log_mutex);
+    
     snprintf(filename, sizeof(filename), "/tmp/lcd-output%d", dev->minor);
     
     file = filp_open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (IS_ERR(file)) {
         dbg_err("Failed to open log file %s\n", filename);
+        kvfree(snapshot);
+        kfree(buf);
         return;
     }
     
-    mutex_lock(&dev->log_mutex);
+    // entries in reverse order (newest first), written a page at a time
+    for (i = (int)count - 1; i >= 0; i--) {
+        if (PAGE_SIZE - len < LOG_ENTRY_SIZE) {
+            kernel_write(file, buf, len, &pos);
+            len = 0;
+        }
+        len += dsim_format_text_record(buf + len, PAGE_SIZE - len, snapshot[i].timestamp_ns,
+                                       snapshot[i].text, snapshot[i].len);
+    }
+    if (len > 0) {
+        kernel_write(file, buf, len, &pos);
+    }
+    
+    filp_close(file, NULL);
+    kvfree(snapshot);
+    kfree(buf);
     
-    // entries in reverse order (newest first)
-    for (i = 0; i < dev->log_count; i++) {
-        idx = (dev->log_head - 1 - i + MAX_LOG_ENTRIES) % MAX_LOG_ENTRIES;
-        kernel_write(file, dev->log_entries[idx], strlen(dev->log_entries[idx]), &pos);
-        kernel_write(file, "\n", 1, &pos);
+    this_cpu_inc(dev->stats->flushes);
+    trace_lcd_sim_flush(dev->minor, count, pos);
+    dbg_dev_info(3, dev->minor, "Log written to %s\n", filename);
+}
+
+// reallocate the ring, keeping the newest entries that still fit
+static int resize_log(struct lcd_device *dev, unsigned int depth)
+{
+    struct lcd_log_record *records, *old;
+    
+    records = kvcalloc(depth, sizeof(*records), GFP_KERNEL);
+    if (!records) {
+        return -ENOMEM;
     }
     
+    mutex_lock(&dev->log_mutex);
+    old = dev->log_records;
+    dev->log_count = copy_log_records(dev, records, depth);
+    dev->log_records = records;
+    WRITE_ONCE(dev->log_depth, depth);
+    dev->log_head = dev->log_count % depth;
     mutex_unlock(&dev->log_mutex);
     
-    filp_close(file, NULL);
+    kvfree(old);
+    return 0;
+}
+
+static void flush_work_handler(struct work_struct *work)
+{
+    struct lcd_device *dev = container_of(to_delayed_work(work), struct lcd_device, flush_work);
     
-    dbg_dev_info(3, dev->minor, "Log written to %s\n", filename);
+    write_log_to_file(dev);
+}
+
+// write pending log entries now and wait for the file to be rewritten
+static ssize_t flush_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct lcd_device *lcd_dev = dev_get_drvdata(dev);
+    if (!lcd_dev) return -ENODEV;
+    
+    flush_delayed_work(&lcd_dev->flush_work);
+    return count;
 }
 
+static ssize_t log_depth_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd_device *lcd_dev = dev_get_drvdata(dev);
+    if (!lcd_dev) return -ENODEV;
+    
+    return sprintf(buf, "%u\n", READ_ONCE(lcd_dev->log_depth));
+}
+
+static ssize_t log_depth_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct lcd_device *lcd_dev = dev_get_drvdata(dev);
+    unsigned int depth;
+    int ret;
+    
+    if (!lcd_dev) return -ENODEV;
+    
+    ret = kstrtouint(buf, 10, &depth);
+    if (ret) return ret;
+    if (depth < 1 || depth > MAX_LOG_DEPTH) return -EINVAL;
+    
+    ret = resize_log(lcd_dev, depth);
+    return ret ? ret : count;
+}
+
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct lcd_device *dev;
+    int result;
+    
+    dev = kzalloc(sizeof(struct lcd_device), GFP_KERNEL);
+    if (!dev) {
+        return -ENOMEM;
+    }
+    
+    dev->log_records = kvcalloc(log_depth, sizeof(struct lcd_log_record), GFP_KERNEL);
+    dev->stats = alloc_percpu(struct lcd_stats);
+    if (!dev->log_records || !dev->stats) {
+        dbg_err("Failed to allocate log for device %d\n", id);
+        kvfree(dev->log_records);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return -ENOMEM;
+    }
+    
+    result = idr_alloc(&devices_idr, dev, id, id + 1, GFP_KERNEL);
+    if (result < 0) {
+        kvfree(dev->log_records);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return result == -ENOSPC ? -EEXIST : result;
+    }
+    
+    // the LCD starts with empty text, kzalloc cleared current_text
+    dev->dev_num = MKDEV(major_number, id);
+    dev->minor = id;
+    dev->log_depth = log_depth;
+    mutex_init(&dev->log_mutex);
+    INIT_DELAYED_WORK(&dev->flush_work, flush_work_handler);
+    mutex_init(&dev->text_mutex);
+    
+    dev->device = device_create(lcd_class, NULL, dev->dev_num, dev, DEVICE_NAME "%d", id);
+    if (IS_ERR(dev->device)) {
+        dbg_err("Failed to create device %d\n", id);
+        result = PTR_ERR(dev->device);
+        goto cleanup_dev;
+    }
+    
+    result = sysfs_create_groups(&dev->device->kobj, lcd_attr_groups);
+    if (result) {
+        dbg_err("Failed to create sysfs attributes for device %d\n", id);
+        device_destroy(lcd_class, dev->dev_num);
+        goto cleanup_dev;
+    }
+    
+    dbg_dev_info(1, id, "LCD device created correctly\n");
+    dbg_dev_info(2, id, "LCD initialized with empty display\n");
+    return 0;
+    
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&dev->log_mutex);
+    mutex_destroy(&dev->text_mutex);
+    kvfree(dev->log_records);
+    free_percpu(dev->stats);
+    kfree(dev);
+    return result;
+}
+
+// caller holds devices_mutex, the device must not be open
+static void destroy_device(struct lcd_device *dev)
+{
+    int id = dev->minor;
+    
+    sysfs_remove_groups(&dev->device->kobj, lcd_attr_groups);
+    device_destroy(lcd_class, dev->dev_num);
+    // persist anything still buffered
+    flush_delayed_work(&dev->flush_work);
+    kvfree(dev->log_records);
+    free_percpu(dev->stats);
+    mutex_destroy(&dev->log_mutex);
+    mutex_destroy(&dev->text_mutex);
+    idr_remove(&devices_idr, id);
+    kfree(dev);
+    
+    dbg_dev_info(1, id, "LCD device removed\n");
+}
+
+static void destroy_all_devices(void)
+{
+    struct lcd_device *dev;
+    int id;
+    
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, dev, id) {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/lcd/new_device creates /dev/lcd-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+    
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+// echo N > /sys/class/lcd/delete_device removes /dev/lcd-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct lcd_device *dev;
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, id);
+    if (!dev) {
+        ret = -ENODEV;
+    } else if (dev->open_count) {
+        ret = -EBUSY;
+    } else {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
 static int __init lcd_init(void)
 {
+    dev_t dev_num;
     int i, result;
     
-    if (num_devices <= 0 || num_devices > MAX_DEVICES) {
-        dbg_err("Invalid number of devices: %d (must be 1-%d)\n", num_devices, MAX_DEVICES);
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
+        dbg_err("Invalid number of devices: %d (must be 0-%d)\n", num_devices, MAX_DEVICES);
+        return -EINVAL;
+    }
+    
+    if (log_depth < 1 || log_depth > MAX_LOG_DEPTH) {
+        dbg_err("Invalid log depth: %u (must be 1-%d)\n", log_depth, MAX_LOG_DEPTH);
         return -EINVAL;
     }
     
     dbg_info(1, "Initializing %d LCD device(s)\n", num_devices);
     
-    result = alloc_chrdev_region(&major_number, 0, num_devices, DEVICE_NAME);
+    // minors are reserved for every possible device
+    result = alloc_chrdev_region(&dev_num, 0, MAX_DEVICES, DEVICE_NAME);
     if (result < 0) {
         dbg_err("Failed to allocate major number\n");
         return result;
     }
-    major_number = MAJOR(major_number);
+    major_number = MAJOR(dev_num);
     dbg_info(1, "Registered correctly with major number %d\n", major_number);
     
+    // one cdev covers the whole minor range, open() looks the device up
+    cdev_init(&lcd_cdev, &fops);
+    lcd_cdev.owner = THIS_MODULE;
+    result = cdev_add(&lcd_cdev, dev_num, MAX_DEVICES);
+    if (result) {
+        dbg_err("Failed to add cdev\n");
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
+        return result;
+    }
+    
     lcd_class = CLASS_CREATE_COMPAT(CLASS_NAME);
     if (IS_ERR(lcd_class)) {
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+        cdev_del(&lcd_cdev);
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
         dbg_err("Failed to create device class\n");
         return PTR_ERR(lcd_class);
     }
     dbg_info(1, "Device class created correctly\n");
     
-    devices = kcalloc(num_devices, sizeof(struct lcd_device), GFP_KERNEL);
-    if (!devices) {
-        class_destroy(lcd_class);
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
-        dbg_err("Failed to allocate memory for devices\n");
-        return -ENOMEM;
+    // create the initial devices, more can be added through new_device
+    result = 0;
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices && !result; i++) {
+        result = create_device(i);
+    }
+    mutex_unlock(&devices_mutex);
+    if (result) {
+        goto cleanup_devices;
     }
     
-    for (i = 0; i < num_devices; i++) {
-        devices[i].dev_num = MKDEV(major_number, i);
-        devices[i].minor = i;
-        devices[i].log_count = 0;
-        devices[i].log_head = 0;
-        mutex_init(&devices[i].log_mutex);
-        mutex_init(&devices[i].text_mutex);
-        
-        // initialize LCD with empty text
-        memset(devices[i].current_text, 0, sizeof(devices[i].current_text));
-        
-        cdev_init(&devices[i].cdev, &fops);
-        devices[i].cdev.owner = THIS_MODULE;
-        
-        result = cdev_add(&devices[i].cdev, devices[i].dev_num, 1);
-        if (result) {
-            dbg_err("Failed to add cdev for device %d\n", i);
-            goto cleanup_devices;
-        }
-        
-        devices[i].device = device_create(lcd_class, NULL, devices[i].dev_num, NULL, DEVICE_NAME "%d", i);
-        if (IS_ERR(devices[i].device)) {
-            dbg_err("Failed to create device %d\n", i);
-            cdev_del(&devices[i].cdev);
-            result = PTR_ERR(devices[i].device);
-            goto cleanup_devices;
-        }
-        
-        dbg_dev_info(1, i, "LCD device created correctly\n");
-        dbg_dev_info(2, i, "LCD initialized with empty display\n");
+    result = class_create_file(lcd_class, &class_attr_new_device);
+    if (result) {
+        goto cleanup_devices;
+    }
+    result = class_create_file(lcd_class, &class_attr_delete_device);
+    if (result) {
+        class_remove_file(lcd_class, &class_attr_new_device);
+        goto cleanup_devices;
     }
     
     dbg_info(1, "Module loaded successfully\n");
     return 0;
     
 cleanup_devices:
-    for (i--; i >= 0; i--) {
-        device_destroy(lcd_class, devices[i].dev_num);
-        cdev_del(&devices[i].cdev);
-        mutex_destroy(&devices[i].log_mutex);
-        mutex_destroy(&devices[i].text_mutex);
-    }
-    kfree(devices);
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
     class_destroy(lcd_class);
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&lcd_cdev);
+    unregister_chrdev_region(dev_num, MAX_DEVICES);
     return result;
 }
 
-static void __exit lcd_exit(void)
+static void __dsim_exit lcd_exit(void)
 {
-    int i;
-    
     dbg_info(1, "Unloading LCD module\n");
     
-    if (devices) {
-        for (i = 0; i < num_devices; i++) {
-            device_destroy(lcd_class, devices[i].dev_num);
-            cdev_del(&devices[i].cdev);
-            mutex_destroy(&devices[i].log_mutex);
-            mutex_destroy(&devices[i].text_mutex);
-        }
-        kfree(devices);
-    }
+    class_remove_file(lcd_class, &class_attr_delete_device);
+    class_remove_file(lcd_class, &class_attr_new_device);
+    
+    // no file can be open here, the module is pinned while one is
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
     
     if (lcd_class) {
         class_destroy(lcd_class);
     }
     
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&lcd_cdev);
+    unregister_chrdev_region(MKDEV(major_number, 0), MAX_DEVICES);
     
     dbg_info(1, "LCD module unloaded successfully\n");
 }
 
-module_init(lcd_init);
-module_exit(lcd_exit);
+DSIM_MODULE(lcd, lcd_init, lcd_exit)
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("DOMIoT");
@@ -0,0 +1,70 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lcd_sim
+
+#if !defined(_LCD_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LCD_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(lcd_sim_file,
+    TP_PROTO(int minor),
+    TP_ARGS(minor),
+    TP_STRUCT__entry(
+        __field(int, minor)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+    ),
+    TP_printk("minor=%d", __entry->minor)
+);
+
+DEFINE_EVENT(lcd_sim_file, lcd_sim_open,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+DEFINE_EVENT(lcd_sim_file, lcd_sim_release,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+// chars is the length of the displayed text, bytes the length of the write
+TRACE_EVENT(lcd_sim_write,
+    TP_PROTO(int minor, int chars, size_t bytes),
+    TP_ARGS(minor, chars, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(int, chars)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->chars = chars;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d chars=%d bytes=%zu", __entry->minor, __entry->chars, __entry->bytes)
+);
+
+// the log file was rewritten with entries records, bytes long
+TRACE_EVENT(lcd_sim_flush,
+    TP_PROTO(int minor, unsigned int entries, size_t bytes),
+    TP_ARGS(minor, entries, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(unsigned int, entries)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->entries = entries;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d entries=%u bytes=%zu", __entry->minor, __entry->entries, __entry->bytes)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
@@ -10,3 +10,5 @@ cd ../lcd-sim
 make load NUM_DEVICES=2
 cd ../video-sim
 make load NUM_DEVICES=2
+cd ../plc-sim
+make load NUM_DEVICES=1
@@ -12,279 +12,666 @@
 #include <linux/rtc.h>
 #include <linux/string.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/idr.h>
+#include <linux/uio.h>
+#include <linux/percpu.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-text.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
 
 #define DEVICE_NAME "ohubx24-sim"
 #define CLASS_NAME "ohubx24"
-#define MAX_DEVICES 10
-#define MAX_LOG_ENTRIES 30
+#define MAX_DEVICES 1024
+#define DEFAULT_LOG_DEPTH 30
+#define MAX_LOG_DEPTH 100000
 #define OUTPUT_LENGTH 24
 #define LOG_ENTRY_SIZE 64
 
 // compatibility macros
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
-    #define CLASS_CREATE_COMPAT(name) class_create(name)
-#else
-    #define CLASS_CREATE_COMPAT(name) class_create(THIS_MODULE, name)
-#endif
-
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
     #define HAVE_PROC_OPS
 #endif
 
+// debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
+static int debug_level = 1;
+module_param(debug_level, int, 0644);
+MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
+
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the ohub parameter of domiot-sim.ko
+extern int domiot_sim_ohub;
+#define num_devices domiot_sim_ohub
+#else
 static int num_devices = 1;
 module_param(num_devices, int, S_IRUGO);
-MODULE_PARM_DESC(num_devices, "Number of devices to create (default: 1)");
+MODULE_PARM_DESC(num_devices, "Number of devices to create at load time (default: 1, max: 1024)");
+#endif
+
+static unsigned int flush_interval_ms = 100;
+module_param(flush_interval_ms, uint, 0644);
+MODULE_PARM_DESC(flush_interval_ms, "Delay before buffered log entries are written to the log file (default: 100)");
+
+static unsigned int log_depth = DEFAULT_LOG_DEPTH;
+module_param(log_depth, uint, S_IRUGO);
+MODULE_PARM_DESC(log_depth, "Initial number of log entries kept per device (default: 30, max: 100000)");
+
+// log entries are kept in binary form and only formatted when exported
+struct ohubx24_log_record {
+    u64 timestamp_ns;       // CLOCK_REALTIME
+    u32 outputs;            // bit n = output channel n
+};
+
+// operation counters, per CPU so that concurrent writers never share a
+// cache line; the stats attributes sum them over all CPUs
+struct ohubx24_stats {
+    u64 writes;
+    u64 bytes_in;
+    u64 state_changes;  // output updates logged, one per frame
+    u64 flushes;        // log file rewrites
+};
 
 struct ohubx24_device {
     dev_t dev_num;
-    struct cdev cdev;
     struct device *device;
     int minor;
-    char log_entries[MAX_LOG_ENTRIES][LOG_ENTRY_SIZE];
-    int log_count;
-    int log_head;
+    // open files, delete_device is refused while non-zero
+    unsigned int open_count;
+    struct ohubx24_log_record *log_records;
+    unsigned int log_depth;
+    unsigned int log_count;
+    unsigned int log_head;
     struct mutex log_mutex;
+    struct delayed_work flush_work;
+    struct ohubx24_stats __percpu *stats;
 };
 
 static int major_number;
+static struct cdev ohubx24_cdev;
 static struct class *ohubx24_class = NULL;
-static struct ohubx24_device *devices = NULL;
+// devices by minor, devices_mutex protects the table and open_count
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
+// ihubx24-sim's wiring entry point while it is loaded, see domiot-sim.h
+static dsim_wire_fn __rcu wire_hook;
 
 static int device_open(struct inode *, struct file *);
 static int device_release(struct inode *, struct file *);
-static ssize_t device_write(struct file *, const char *, size_t, loff_t *);
-static void add_log_entry(struct ohubx24_device *dev, const char *output);
+static ssize_t device_write_iter(struct kiocb *, struct iov_iter *);
+static void add_log_entry(struct ohubx24_device *dev, u32 outputs);
 static void write_log_to_file(struct ohubx24_device *dev);
 
 static struct file_operations fops = {
     .open = device_open,
-    .write = device_write,
+    .write_iter = device_write_iter,
     .release = device_release,
 };
 
+static ssize_t flush_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t log_depth_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t log_depth_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+
+static DEVICE_ATTR(flush, 0200, NULL, flush_store);
+static DEVICE_ATTR(log_depth, 0644, log_depth_show, log_depth_store);
+
+static struct attribute *ohubx24_attrs[] = {
+    &dev_attr_flush.attr,
+    &dev_attr_log_depth.attr,
+    NULL,
+};
+
+static const struct attribute_group ohubx24_attr_group = {
+    .attrs = ohubx24_attrs,
+};
+
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct ohubx24_device, struct ohubx24_stats, field)
+
+STATS_ATTR(writes);
+STATS_ATTR(bytes_in);
+STATS_ATTR(state_changes);
+STATS_ATTR(flushes);
+
+static struct attribute *ohubx24_stats_attrs[] = {
+    &dev_attr_stats_writes.attr,
+    &dev_attr_stats_bytes_in.attr,
+    &dev_attr_stats_state_changes.attr,
+    &dev_attr_stats_flushes.attr,
+    NULL,
+};
+
+// /sys/class/ohubx24/ohubx24-simN/stats/
+static const struct attribute_group ohubx24_stats_group = {
+    .name = "stats",
+    .attrs = ohubx24_stats_attrs,
+};
+
+static const struct attribute_group *ohubx24_attr_groups[] = {
+    &ohubx24_attr_group,
+    &ohubx24_stats_group,
+    NULL,
+};
+
 static int device_open(struct inode *inodep, struct file *filep)
 {
+    struct ohubx24_device *dev;
     int minor = iminor(inodep);
-    if (minor >= num_devices) {
+    
+    // keep the device from being deleted while it is open
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        dev->open_count++;
+    }
+    mutex_unlock(&devices_mutex);
+    if (!dev) {
         return -ENODEV;
     }
     
-    filep->private_data = &devices[minor];
+    filep->private_data = dev;
+    trace_ohubx24_sim_open(minor);
     printk(KERN_INFO "ohubx24-sim: Device %d has been opened\n", minor);
     return 0;
 }
 
-static ssize_t device_write(struct file *filep, const char *buffer, size_t len, loff_t *offset)
+// consume len bytes of the iterator as one frame of '0'/'1' digits, outputs
+// without a digit are 0; returns the output bitmask or -EFAULT. Copying
+// stops once all outputs are set, the rest of the frame is skipped.
+static s64 parse_frame(struct iov_iter *from, size_t len, char *output)
 {
-    struct ohubx24_device *dev = (struct ohubx24_device *)filep->private_data;
-    char *user_input = NULL;
-    char output[OUTPUT_LENGTH + 1];
-    int i, valid_digits = 0;
+    char chunk[64];
+    size_t n;
+    u32 outputs = 0;
+    int valid_digits = 0;
     
-    if (len == 0) {
-        return 0;
-    }
+    // initialize output with zeros
+    memset(output, '0', OUTPUT_LENGTH);
+    output[OUTPUT_LENGTH] = '\0';
     
-    // allocate memory for user input
-    user_input = kmalloc(len + 1, GFP_KERNEL);
-    if (!user_input) {
-        return -ENOMEM;
+    while (len > 0 && valid_digits < OUTPUT_LENGTH) {
+        n = min(len, sizeof(chunk));
+        if (copy_from_iter(chunk, n, from) != n) {
+            return -EFAULT;
+        }
+        len -= n;
+        
+        valid_digits = dsim_parse_digits(chunk, n, output, &outputs, valid_digits, OUTPUT_LENGTH);
     }
+    iov_iter_advance(from, len);
+    return outputs;
+}
+
+// each iovec segment is an independent frame, so one writev() or a batch
+// of io_uring writes logs several output updates
+static ssize_t device_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+    struct ohubx24_device *dev = (struct ohubx24_device *)iocb->ki_filp->private_data;
+    char output[OUTPUT_LENGTH + 1];
+    size_t len = iov_iter_count(from);
+    s64 outputs;
     
-    if (copy_from_user(user_input, buffer, len)) {
-        kfree(user_input);
-        return -EFAULT;
+    if (len == 0) {
+        return 0;
     }
-    user_input[len] = '\0';
     
-    // initialize output with zeros
-    memset(output, '0', OUTPUT_LENGTH);
-    output[OUTPUT_LENGTH] = '\0';
-    
-    for (i = 0; i < len && valid_digits < OUTPUT_LENGTH; i++) {
-        if (user_input[i] == '0' || user_input[i] == '1') {
-            output[valid_digits] = user_input[i];
-            valid_digits++;
-        } else if (user_input[i] == '\n' || user_input[i] == '\r') {
-            // Ignore newlines and carriage returns
-            continue;
+    while (iov_iter_count(from) > 0) {
+        size_t done = len - iov_iter_count(from);
+        
+        outputs = parse_frame(from, iter_segment_len(from), output);
+        if (outputs < 0) {
+            len = done;
+            break;
         }
+        
+        add_log_entry(dev, outputs);
+        this_cpu_inc(dev->stats->state_changes);
+        trace_ohubx24_sim_write(dev->minor, outputs, len - iov_iter_count(from) - done);
+        dbg_dev_info(3, dev->minor, "Received: %s\n", output);
     }
     
-    // add log entry and write to file
-    add_log_entry(dev, output);
-    write_log_to_file(dev);
+    this_cpu_inc(dev->stats->writes);
+    this_cpu_add(dev->stats->bytes_in, len);
     
-    printk(KERN_INFO "ohubx24-sim: Device %d received: %s\n", dev->minor, output);
+    // the file is rewritten once per flush interval
+    if (len > 0) {
+        schedule_delayed_work(&dev->flush_work, msecs_to_jiffies(flush_interval_ms));
+    }
     
-    kfree(user_input);
-    return len;
+    return len ? len : -EFAULT;
 }
 
 static int device_release(struct inode *inodep, struct file *filep)
 {
     struct ohubx24_device *dev = (struct ohubx24_device *)filep->private_data;
+    
+    mutex_lock(&devices_mutex);
+    dev->open_count--;
+    mutex_unlock(&devices_mutex);
+    
+    trace_ohubx24_sim_release(dev->minor);
     printk(KERN_INFO "ohubx24-sim: Device %d has been closed\n", dev->minor);
     return 0;
 }
 
-static void add_log_entry(struct ohubx24_device *dev, const char *output)
+static void add_log_entry(struct ohubx24_device *dev, u32 outputs)
 {
-    struct timespec64 ts;
-    struct tm tm;
+    struct ohubx24_log_record *record;
     
     mutex_lock(&dev->log_mutex);
     
-    ktime_get_real_ts64(&ts);
-    time64_to_tm(ts.tv_sec, 0, &tm);
-    
-    // Format: "YYYY-MM-DD HH:MM:SS <24-digit-output>"
-    snprintf(dev->log_entries[dev->log_head], LOG_ENTRY_SIZE,
-             "%04ld-%02d-%02d %02d:%02d:%02d %s",
-             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-             tm.tm_hour, tm.tm_min, tm.tm_sec, output);
+    record = &dev->log_records[dev->log_head];
+    record->timestamp_ns = ktime_get_real_ns();
+    record->outputs = outputs;
     
-    dev->log_head = (dev->log_head + 1) % MAX_LOG_ENTRIES;
-    if (dev->log_count < MAX_LOG_ENTRIES) {
+    dev->log_head = (dev->log_head + 1) % dev->log_depth;
+    if (dev->log_count < dev->log_depth) {
         dev->log_count++;
     }
     
+    // under log_mutex so that wired ihubx24-sim inputs follow the log order
+    dsim_wire_outputs(&wire_hook, DSIM_WIRE_OHUBX24, dev->minor, outputs);
+    
     mutex_unlock(&dev->log_mutex);
 }
 
+// log an output update like a one frame write, for plc-sim
+int ohubx24_sim_set_outputs(int minor, u32 outputs)
+{
+    struct ohubx24_device *dev;
+    
+    outputs &= GENMASK(OUTPUT_LENGTH - 1, 0);
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        add_log_entry(dev, outputs);
+        this_cpu_inc(dev->stats->state_changes);
+        this_cpu_inc(dev->stats->writes);
+        trace_ohubx24_sim_write(dev->minor, outputs, 0);
+        schedule_delayed_work(&dev->flush_work, msecs_to_jiffies(flush_interval_ms));
+    }
+    mutex_unlock(&devices_mutex);
+    return dev ? 0 : -ENODEV;
+}
+EXPORT_SYMBOL_GPL(ohubx24_sim_set_outputs);
+
+// set by ihubx24-sim when it or this module is loaded, cleared when it unloads
+void ohubx24_sim_set_wire_hook(dsim_wire_fn fn)
+{
+    rcu_assign_pointer(wire_hook, fn);
+}
+EXPORT_SYMBOL_GPL(ohubx24_sim_set_wire_hook);
+
+// oldest-first copy of the newest max entries, caller holds log_mutex
+static unsigned int copy_log_records(struct ohubx24_device *dev, struct ohubx24_log_record *dst, unsigned int max)
+{
+    unsigned int n = min(dev->log_count, max);
+    unsigned int i;
+    
+    for (i = 0; i < n; i++) {
+        dst[i] = dev->log_records[(dev->log_head + dev->log_depth - n + i) % dev->log_depth];
+    }
+    return n;
+}
+
 static void write_log_to_file(struct ohubx24_device *dev)
 {
+    struct ohubx24_log_record *snapshot;
     struct file *file;
     char filename[32];
-    int i, idx;
+    char *buf;
+    size_t len = 0;
+    unsigned int count, depth;
+    int i;
     loff_t pos = 0;
     
+    depth = READ_ONCE(dev->log_depth);
+    snapshot = kvmalloc_array(depth, sizeof(*snapshot), GFP_KERNEL);
+    buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+    if (!snapshot || !buf) {
+        printk(KERN_ERR "ohubx24-sim: Failed to allocate log snapshot\n");
+        kvfree(snapshot);
+        kfree(buf);
+        return;
+    }
+    
+    // snapshot the binary records so writers are not blocked by formatting or file I/O
+    mutex_lock(&dev->log_mutex);
+    count = copy_log_records(dev, snapshot, depth);
+    mutex_unlock(&dev->log_mutex);
+    
     snprintf(filename, sizeof(filename), "/tmp/ohubx24-output%d", dev->minor);
     
     file = filp_open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (IS_ERR(file)) {
         printk(KERN_ERR "ohubx24-sim: Failed to open log file %s\n", filename);
+        kvfree(snapshot);
+        kfree(buf);
         return;
     }
     
-    mutex_lock(&dev->log_mutex);
+    // entries in reverse order (newest first), written a page at a time
+    for (i = (int)count - 1; i >= 0; i--) {
+        if (PAGE_SIZE - len < LOG_ENTRY_SIZE) {
+            kernel_write(file, buf, len, &pos);
+            len = 0;
+        }
+        len += dsim_format_outputs_record(buf + len, PAGE_SIZE - len, snapshot[i].timestamp_ns,
+                                          snapshot[i].outputs, OUTPUT_LENGTH);
+    }
+    if (len > 0) {
+        kernel_write(file, buf, len, &pos);
+    }
     
-    // Write entries in reverse order (newest first)
-    for (i = 0; i < dev->log_count; i++) {
-        idx = (dev->log_head - 1 - i + MAX_LOG_ENTRIES) % MAX_LOG_ENTRIES;
-        kernel_write(file, dev->log_entries[idx], strlen(dev->log_entries[idx]), &pos);
-        kernel_write(file, "\n", 1, &pos);
+    filp_close(file, NULL);
+    kvfree(snapshot);
+    kfree(buf);
+    
+    this_cpu_inc(dev->stats->flushes);
+    trace_ohubx24_sim_flush(dev->minor, count, pos);
+}
+
+// reallocate the ring, keeping the newest entries that still fit
+static int resize_log(struct ohubx24_device *dev, unsigned int depth)
+{
+    struct ohubx24_log_record *records, *old;
+    
+    records = kvcalloc(depth, sizeof(*records), GFP_KERNEL);
+    if (!records) {
+        return -ENOMEM;
     }
     
+    mutex_lock(&dev->log_mutex);
+    old = dev->log_records;
+    dev->log_count = copy_log_records(dev, records, depth);
+    dev->log_records = records;
+    WRITE_ONCE(dev->log_depth, depth);
+    dev->log_head = dev->log_count % depth;
     mutex_unlock(&dev->log_mutex);
     
-    filp_close(file, NULL);
+    kvfree(old);
+    return 0;
+}
+
+static void flush_work_handler(struct work_struct *work)
+{
+    struct ohubx24_device *dev = container_of(to_delayed_work(work), struct ohubx24_device, flush_work);
+    
+    write_log_to_file(dev);
+}
+
+// write pending log entries now and wait for the file to be rewritten
+static ssize_t flush_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ohubx24_device *ohub_dev = dev_get_drvdata(dev);
+    if (!ohub_dev) return -ENODEV;
+    
+    flush_delayed_work(&ohub_dev->flush_work);
+    return count;
+}
+
+static ssize_t log_depth_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ohubx24_device *ohub_dev = dev_get_drvdata(dev);
+    if (!ohub_dev) return -ENODEV;
+    
+    return sprintf(buf, "%u\n", READ_ONCE(ohub_dev->log_depth));
+}
+
+static ssize_t log_depth_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct ohubx24_device *ohub_dev = dev_get_drvdata(dev);
+    unsigned int depth;
+    int ret;
+    
+    if (!ohub_dev) return -ENODEV;
+    
+    ret = kstrtouint(buf, 10, &depth);
+    if (ret) return ret;
+    if (depth < 1 || depth > MAX_LOG_DEPTH) return -EINVAL;
+    
+    ret = resize_log(ohub_dev, depth);
+    return ret ? ret : count;
+}
+
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct ohubx24_device *dev;
+    int result;
+    
+    dev = kzalloc(sizeof(struct ohubx24_device), GFP_KERNEL);
+    if (!dev) {
+        return -ENOMEM;
+    }
+    
+    dev->log_records = kvcalloc(log_depth, sizeof(struct ohubx24_log_record), GFP_KERNEL);
+    dev->stats = alloc_percpu(struct ohubx24_stats);
+    if (!dev->log_records || !dev->stats) {
+        printk(KERN_ERR "ohubx24-sim: Failed to allocate log for device %d\n", id);
+        kvfree(dev->log_records);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return -ENOMEM;
+    }
+    
+    result = idr_alloc(&devices_idr, dev, id, id + 1, GFP_KERNEL);
+    if (result < 0) {
+        kvfree(dev->log_records);
+        free_percpu(dev->stats);
+        kfree(dev);
+        return result == -ENOSPC ? -EEXIST : result;
+    }
+    
+    dev->dev_num = MKDEV(major_number, id);
+    dev->minor = id;
+    dev->log_depth = log_depth;
+    mutex_init(&dev->log_mutex);
+    INIT_DELAYED_WORK(&dev->flush_work, flush_work_handler);
+    
+    // create device
+    dev->device = device_create(ohubx24_class, NULL, dev->dev_num, dev, DEVICE_NAME "%d", id);
+    if (IS_ERR(dev->device)) {
+        printk(KERN_ERR "ohubx24-sim: Failed to create device %d\n", id);
+        result = PTR_ERR(dev->device);
+        goto cleanup_dev;
+    }
+    
+    result = sysfs_create_groups(&dev->device->kobj, ohubx24_attr_groups);
+    if (result) {
+        printk(KERN_ERR "ohubx24-sim: Failed to create sysfs attributes for device %d\n", id);
+        device_destroy(ohubx24_class, dev->dev_num);
+        goto cleanup_dev;
+    }
+    
+    printk(KERN_INFO "ohubx24-sim: Created /dev/%s%d\n", DEVICE_NAME, id);
+    return 0;
+    
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&dev->log_mutex);
+    kvfree(dev->log_records);
+    free_percpu(dev->stats);
+    kfree(dev);
+    return result;
+}
+
+// caller holds devices_mutex, the device must not be open
+static void destroy_device(struct ohubx24_device *dev)
+{
+    int id = dev->minor;
+    
+    sysfs_remove_groups(&dev->device->kobj, ohubx24_attr_groups);
+    device_destroy(ohubx24_class, dev->dev_num);
+    // persist anything still buffered
+    flush_delayed_work(&dev->flush_work);
+    kvfree(dev->log_records);
+    free_percpu(dev->stats);
+    mutex_destroy(&dev->log_mutex);
+    idr_remove(&devices_idr, id);
+    kfree(dev);
+    
+    printk(KERN_INFO "ohubx24-sim: Removed /dev/%s%d\n", DEVICE_NAME, id);
+}
+
+static void destroy_all_devices(void)
+{
+    struct ohubx24_device *dev;
+    int id;
+    
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, dev, id) {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/ohubx24/new_device creates /dev/ohubx24-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+    
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
 }
 
+// echo N > /sys/class/ohubx24/delete_device removes /dev/ohubx24-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct ohubx24_device *dev;
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, id);
+    if (!dev) {
+        ret = -ENODEV;
+    } else if (dev->open_count) {
+        ret = -EBUSY;
+    } else {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
 static int __init ohubx24_init(void)
 {
+    dev_t dev_num;
     int i, result;
     
     printk(KERN_INFO "ohubx24-sim: Initializing with %d devices\n", num_devices);
     
-    if (num_devices <= 0 || num_devices > MAX_DEVICES) {
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
         printk(KERN_ERR "ohubx24-sim: Invalid number of devices: %d\n", num_devices);
         return -EINVAL;
     }
     
-    // allocate major number
-    result = alloc_chrdev_region(&major_number, 0, num_devices, DEVICE_NAME);
+    if (log_depth < 1 || log_depth > MAX_LOG_DEPTH) {
+        printk(KERN_ERR "ohubx24-sim: Invalid log depth: %u\n", log_depth);
+        return -EINVAL;
+    }
+    
+    // allocate major number, minors are reserved for every possible device
+    result = alloc_chrdev_region(&dev_num, 0, MAX_DEVICES, DEVICE_NAME);
     if (result < 0) {
         printk(KERN_ERR "ohubx24-sim: Failed to allocate major number\n");
         return result;
     }
-    major_number = MAJOR(major_number);
+    major_number = MAJOR(dev_num);
+    
+    // one cdev covers the whole minor range, open() looks the device up
+    cdev_init(&ohubx24_cdev, &fops);
+    ohubx24_cdev.owner = THIS_MODULE;
+    result = cdev_add(&ohubx24_cdev, dev_num, MAX_DEVICES);
+    if (result) {
+        printk(KERN_ERR "ohubx24-sim: Failed to add cdev\n");
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
+        return result;
+    }
     
     ohubx24_class = CLASS_CREATE_COMPAT(CLASS_NAME);
     if (IS_ERR(ohubx24_class)) {
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+        cdev_del(&ohubx24_cdev);
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
         printk(KERN_ERR "ohubx24-sim: Failed to create device class\n");
         return PTR_ERR(ohubx24_class);
     }
     
-    devices = kcalloc(num_devices, sizeof(struct ohubx24_device), GFP_KERNEL);
-    if (!devices) {
-        class_destroy(ohubx24_class);
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
-        return -ENOMEM;
+    // create the initial devices, more can be added through new_device
+    result = 0;
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices && !result; i++) {
+        result = create_device(i);
+    }
+    mutex_unlock(&devices_mutex);
+    if (result) {
+        goto cleanup_devices;
     }
     
-    // initialize devices
-    for (i = 0; i < num_devices; i++) {
-        devices[i].dev_num = MKDEV(major_number, i);
-        devices[i].minor = i;
-        devices[i].log_count = 0;
-        devices[i].log_head = 0;
-        mutex_init(&devices[i].log_mutex);
-        
-        // initialize cdev
-        cdev_init(&devices[i].cdev, &fops);
-        devices[i].cdev.owner = THIS_MODULE;
-        
-        result = cdev_add(&devices[i].cdev, devices[i].dev_num, 1);
-        if (result) {
-            printk(KERN_ERR "ohubx24-sim: Failed to add cdev for device %d\n", i);
-            goto cleanup_devices;
-        }
-        
-        // create device
-        devices[i].device = device_create(ohubx24_class, NULL, devices[i].dev_num, NULL, DEVICE_NAME "%d", i);
-        if (IS_ERR(devices[i].device)) {
-            printk(KERN_ERR "ohubx24-sim: Failed to create device %d\n", i);
-            cdev_del(&devices[i].cdev);
-            result = PTR_ERR(devices[i].device);
-            goto cleanup_devices;
-        }
-        
-        printk(KERN_INFO "ohubx24-sim: Created /dev/%s%d\n", DEVICE_NAME, i);
+    result = class_create_file(ohubx24_class, &class_attr_new_device);
+    if (result) {
+        goto cleanup_devices;
+    }
+    result = class_create_file(ohubx24_class, &class_attr_delete_device);
+    if (result) {
+        class_remove_file(ohubx24_class, &class_attr_new_device);
+        goto cleanup_devices;
     }
     
     printk(KERN_INFO "ohubx24-sim: Module loaded successfully\n");
     return 0;
     
 cleanup_devices:
-    for (i--; i >= 0; i--) {
-        device_destroy(ohubx24_class, devices[i].dev_num);
-        cdev_del(&devices[i].cdev);
-        mutex_destroy(&devices[i].log_mutex);
-    }
-    kfree(devices);
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
     class_destroy(ohubx24_class);
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&ohubx24_cdev);
+    unregister_chrdev_region(dev_num, MAX_DEVICES);
     return result;
 }
 
-static void __exit ohubx24_exit(void)
+static void __dsim_exit ohubx24_exit(void)
 {
-    int i;
-    
     printk(KERN_INFO "ohubx24-sim: Unloading module\n");
     
-    if (devices) {
-        for (i = 0; i < num_devices; i++) {
-            device_destroy(ohubx24_class, devices[i].dev_num);
-            cdev_del(&devices[i].cdev);
-            mutex_destroy(&devices[i].log_mutex);
-        }
-        kfree(devices);
-    }
+    class_remove_file(ohubx24_class, &class_attr_delete_device);
+    class_remove_file(ohubx24_class, &class_attr_new_device);
+    
+    // no file can be open here, the module is pinned while one is
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
     
     if (ohubx24_class) {
         class_destroy(ohubx24_class);
     }
     
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&ohubx24_cdev);
+    unregister_chrdev_region(MKDEV(major_number, 0), MAX_DEVICES);
     
     printk(KERN_INFO "ohubx24-sim: Module unloaded successfully\n");
 }
 
-module_init(ohubx24_init);
-module_exit(ohubx24_exit);
+DSIM_MODULE(ohub, ohubx24_init, ohubx24_exit)
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("DOMIoT");
@@ -0,0 +1,70 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ohubx24_sim
+
+#if !defined(_OHUBX24_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _OHUBX24_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(ohubx24_sim_file,
+    TP_PROTO(int minor),
+    TP_ARGS(minor),
+    TP_STRUCT__entry(
+        __field(int, minor)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+    ),
+    TP_printk("minor=%d", __entry->minor)
+);
+
+DEFINE_EVENT(ohubx24_sim_file, ohubx24_sim_open,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+DEFINE_EVENT(ohubx24_sim_file, ohubx24_sim_release,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+// one event per frame, bytes is the length of the frame
+TRACE_EVENT(ohubx24_sim_write,
+    TP_PROTO(int minor, u32 outputs, size_t bytes),
+    TP_ARGS(minor, outputs, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, outputs)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->outputs = outputs;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d outputs=%06x bytes=%zu", __entry->minor, __entry->outputs, __entry->bytes)
+);
+
+// the log file was rewritten with entries records, bytes long
+TRACE_EVENT(ohubx24_sim_flush,
+    TP_PROTO(int minor, unsigned int entries, size_t bytes),
+    TP_ARGS(minor, entries, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(unsigned int, entries)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->entries = entries;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d entries=%u bytes=%zu", __entry->minor, __entry->entries, __entry->bytes)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
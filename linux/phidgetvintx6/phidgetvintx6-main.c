@@ -8,13 +8,21 @@
 #include <linux/jiffies.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
-#include <linux/list.h>
+#include <linux/atomic.h>
 #include <linux/slab.h>
 #include <linux/version.h>
 #include <linux/mutex.h>
 #include <linux/string.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-text.h"
+#include "domiot-sim-events.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
 
 #define DEVICE_NAME "phidgetvintx6"
 #define CLASS_NAME "phidgetvintx6"
@@ -32,16 +40,10 @@ static int num_devices = 1;
 module_param(num_devices, int, 0644);
 MODULE_PARM_DESC(num_devices, "Number of phidgetvintx6 devices to create (default: 1, max: 10)");
 
-// debug macros to reduce overhead
-#define dbg_err(fmt, ...) printk(KERN_ERR "phidgetvintx6: " fmt, ##__VA_ARGS__)
-#define dbg_info(level, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "phidgetvintx6: " fmt, ##__VA_ARGS__); } while(0)
-#define dbg_dev_info(level, dev_id, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "phidgetvintx6%d: " fmt, dev_id, ##__VA_ARGS__); } while(0)
-
 struct phidgetvintx6_reader {
-    struct list_head list;
-    wait_queue_head_t wait;
-    int state_changed;
     struct phidgetvintx6_device *device;
+    // generation returned by the last read
+    u64 seen_generation;
 };
 
 struct phidgetvintx6_device {
@@ -50,14 +52,19 @@ struct phidgetvintx6_device {
     char channel_states[NUM_CHANNELS];
     char prev_channel_states[NUM_CHANNELS];
     char output_states[NUM_CHANNELS];
-    struct list_head readers_list;
-    spinlock_t readers_lock;
+    // published under state_mutex on every input change, readers sleep
+    // until it moves past their seen_generation
+    struct dsim_notifier notify;
     struct mutex state_mutex;
     int daemon_connected;
 };
 
 static int major_number;
 static struct class *phidgetvintx6_class = NULL;
+// state change events of all the devices, see domiot-sim-events.h
+static struct dsim_events *event_bus;
+// readers are allocated on every open, from a dedicated cache
+static struct kmem_cache *reader_cache;
 static struct phidgetvintx6_device *devices = NULL;
 
 struct phidgetvintx6_reader;
@@ -91,6 +98,7 @@ static const struct attribute_group phidgetvintx6_attr_group = {
 };
 
 static struct file_operations fops = {
+    .owner = THIS_MODULE,
     .open = dev_open,
     .read = dev_read,
     .write = dev_write,
@@ -98,6 +106,25 @@ static struct file_operations fops = {
     .poll = dev_poll,
 };
 
+static inline bool reader_has_data(struct phidgetvintx6_reader *reader)
+{
+    return dsim_pending(&reader->device->notify, reader->seen_generation);
+}
+
+// bit n = channel n, only used for tracing
+static u32 channel_states_to_bits(const char *states)
+{
+    u32 bits = 0;
+    int i;
+    
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        if (states[i] == '1') {
+            bits |= BIT(i);
+        }
+    }
+    return bits;
+}
+
 // Sysfs attribute implementations
 static ssize_t input_states_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
@@ -116,7 +143,6 @@ static ssize_t input_states_show(struct device *dev, struct device_attribute *at
 static ssize_t input_states_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
     struct phidgetvintx6_device *phidget_dev = dev_get_drvdata(dev);
-    struct phidgetvintx6_reader *reader;
     int i, changed = 0;
     
     if (!phidget_dev) return -ENODEV;
@@ -136,17 +162,24 @@ static ssize_t input_states_store(struct device *dev, struct device_attribute *a
             }
         }
     }
+    if (changed) {
+        u64 seq = dsim_publish(&phidget_dev->notify);
+
+        dsim_event(event_bus, phidget_dev->device_id, seq, ktime_get_ns(),
+                   channel_states_to_bits(phidget_dev->channel_states));
+        if (trace_phidgetvintx6_state_change_enabled()) {
+            trace_phidgetvintx6_state_change(phidget_dev->device_id,
+                                             channel_states_to_bits(phidget_dev->prev_channel_states),
+                                             channel_states_to_bits(phidget_dev->channel_states),
+                                             dsim_generation(&phidget_dev->notify));
+        }
+    }
     
     mutex_unlock(&phidget_dev->state_mutex);
     
-    // Wake up waiting readers if state changed
+    // Wake up waiting readers if state changed, one call for all of them
     if (changed) {
-        spin_lock(&phidget_dev->readers_lock);
-        list_for_each_entry(reader, &phidget_dev->readers_list, list) {
-            reader->state_changed = 1;
-            wake_up_interruptible(&reader->wait);
-        }
-        spin_unlock(&phidget_dev->readers_lock);
+        dsim_wake(&phidget_dev->notify);
         
         dbg_dev_info(3, phidget_dev->device_id, "Input states updated from daemon: %.6s\n", phidget_dev->channel_states);
     }
@@ -210,32 +243,43 @@ static int __init phidgetvintx6_init(void) {
         return -ENOMEM;
     }
 
+    reader_cache = KMEM_CACHE(phidgetvintx6_reader, 0);
+    if (!reader_cache) {
+        kfree(devices);
+        return -ENOMEM;
+    }
+
     major_number = register_chrdev(0, DEVICE_NAME, &fops);
     if (major_number < 0) {
         dbg_err("Failed to register a major number\n");
+        kmem_cache_destroy(reader_cache);
         kfree(devices);
         return major_number;
     }
     dbg_info(1, "Registered correctly with major number %d\n", major_number);
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
-    phidgetvintx6_class = class_create(CLASS_NAME);
-#else
-    phidgetvintx6_class = class_create(THIS_MODULE, CLASS_NAME);
-#endif
+    phidgetvintx6_class = CLASS_CREATE_COMPAT(CLASS_NAME);
     if (IS_ERR(phidgetvintx6_class)) {
         unregister_chrdev(major_number, DEVICE_NAME);
+        kmem_cache_destroy(reader_cache);
         kfree(devices);
         dbg_err("Failed to register device class\n");
         return PTR_ERR(phidgetvintx6_class);
     }
     dbg_info(1, "Device class registered correctly\n");
 
+    event_bus = dsim_events_register("phidgetvintx6", DSIM_EVENTS_PHIDGETVINTX6);
+    if (IS_ERR(event_bus)) {
+        ret = PTR_ERR(event_bus);
+        dbg_err("Failed to register the events family\n");
+        i = 0;
+        goto cleanup_devices;
+    }
+
     // create multiple devices
     for (i = 0; i < num_devices; i++) {
         devices[i].device_id = i;
-        INIT_LIST_HEAD(&devices[i].readers_list);
-        spin_lock_init(&devices[i].readers_lock);
+        dsim_notifier_init(&devices[i].notify);
         mutex_init(&devices[i].state_mutex);
         devices[i].daemon_connected = 0;
         
@@ -279,34 +323,31 @@ cleanup_devices:
         sysfs_remove_group(&devices[j].device->kobj, &phidgetvintx6_attr_group);
         device_destroy(phidgetvintx6_class, MKDEV(major_number, j));
     }
+    dsim_events_unregister(event_bus);
     class_destroy(phidgetvintx6_class);
     unregister_chrdev(major_number, DEVICE_NAME);
+    kmem_cache_destroy(reader_cache);
     kfree(devices);
     return ret;
 }
 
 static void __exit phidgetvintx6_exit(void) {
-    struct phidgetvintx6_reader *reader, *tmp;
     int i;
     
     if (devices) {
         for (i = 0; i < num_devices; i++) {
-            spin_lock(&devices[i].readers_lock);
-            list_for_each_entry_safe(reader, tmp, &devices[i].readers_list, list) {
-                list_del(&reader->list);
-                kfree(reader);
-            }
-            spin_unlock(&devices[i].readers_lock);
-            
             sysfs_remove_group(&devices[i].device->kobj, &phidgetvintx6_attr_group);
             device_destroy(phidgetvintx6_class, MKDEV(major_number, i));
         }
         kfree(devices);
     }
+    dsim_events_unregister(event_bus);
     
     class_unregister(phidgetvintx6_class);
     class_destroy(phidgetvintx6_class);
     unregister_chrdev(major_number, DEVICE_NAME);
+    // no reader is left, the module is pinned while a file is open
+    kmem_cache_destroy(reader_cache);
     dbg_info(1, "Driver unloaded\n");
 }
 
@@ -319,20 +360,17 @@ static int dev_open(struct inode *inodep, struct file *filep) {
         return -ENODEV;
     }
     
-    reader = kmalloc(sizeof(struct phidgetvintx6_reader), GFP_KERNEL);
+    reader = kmem_cache_alloc(reader_cache, GFP_KERNEL);
     if (!reader) {
         return -ENOMEM;
     }
     
-    init_waitqueue_head(&reader->wait);
-    reader->state_changed = 1;
     reader->device = &devices[minor];
-    
-    spin_lock(&devices[minor].readers_lock);
-    list_add(&reader->list, &devices[minor].readers_list);
-    spin_unlock(&devices[minor].readers_lock);
+    // the first read returns the current state
+    reader->seen_generation = dsim_generation(&devices[minor].notify) - 1;
     
     filep->private_data = reader;
+    trace_phidgetvintx6_open(minor);
     dbg_dev_info(2, minor, "Device opened\n");
     return 0;
 }
@@ -342,12 +380,10 @@ static int dev_release(struct inode *inodep, struct file *filep) {
     int minor = iminor(inodep);
     
     if (reader && reader->device) {
-        spin_lock(&reader->device->readers_lock);
-        list_del(&reader->list);
-        spin_unlock(&reader->device->readers_lock);
-        kfree(reader);
+        kmem_cache_free(reader_cache, reader);
     }
     
+    trace_phidgetvintx6_release(minor);
     dbg_dev_info(2, minor, "Device closed\n");
     return 0;
 }
@@ -369,19 +405,21 @@ static ssize_t dev_read(struct file *filep, char *buffer, size_t len, loff_t *of
     }
     
     // wait for state change if needed (for blocking reads)
-    if (!reader->state_changed) {
+    if (!reader_has_data(reader)) {
         if (filep->f_flags & O_NONBLOCK) {
             return -EAGAIN;
         }
-        if (wait_event_interruptible(reader->wait, reader->state_changed)) {
+        if (wait_event_interruptible(reader->device->notify.wait, reader_has_data(reader))) {
             return -ERESTARTSYS;
         }
+        trace_phidgetvintx6_wakeup(reader->device->device_id, dsim_generation(&reader->device->notify));
     }
     
-    reader->state_changed = 0;
-    
     mutex_lock(&reader->device->state_mutex);
     
+    // the generation only moves under state_mutex, so it matches the copy
+    reader->seen_generation = dsim_generation(&reader->device->notify);
+    
     // copy channel states and add newline
     memcpy(message, reader->device->channel_states, NUM_CHANNELS);
     message[NUM_CHANNELS] = '\n';
@@ -394,6 +432,9 @@ static ssize_t dev_read(struct file *filep, char *buffer, size_t len, loff_t *of
         return -EFAULT;
     }
     
+    if (trace_phidgetvintx6_read_enabled()) {
+        trace_phidgetvintx6_read(reader->device->device_id, channel_states_to_bits(message), BUFFER_SIZE);
+    }
     dbg_dev_info(3, reader->device->device_id, "Read channel states: %.6s\n", message);
     return BUFFER_SIZE;
 }
@@ -401,8 +442,10 @@ static ssize_t dev_read(struct file *filep, char *buffer, size_t len, loff_t *of
 static ssize_t dev_write(struct file *filep, const char *buffer, size_t len, loff_t *offset) {
     struct phidgetvintx6_reader *writer_reader = filep->private_data;
     struct phidgetvintx6_device *dev = writer_reader->device;
-    char *user_input = NULL;
-    int i, valid_digits = 0;
+    char states[NUM_CHANNELS];
+    char chunk[64];
+    size_t done = 0, n;
+    int valid_digits = 0;
     
     if (!dev) {
         dbg_err("Invalid device pointer\n");
@@ -419,39 +462,29 @@ static ssize_t dev_write(struct file *filep, const char *buffer, size_t len, lof
         return 0;
     }
     
-    user_input = kmalloc(len + 1, GFP_KERNEL);
-    if (!user_input) {
-        dbg_err("Failed to allocate memory for user input\n");
-        return -ENOMEM;
-    }
-    
-    if (copy_from_user(user_input, buffer, len)) {
-        kfree(user_input);
-        return -EFAULT;
+    // copy in small chunks until all channels are set, the rest of the
+    // buffer is accepted without being read
+    memset(states, '0', NUM_CHANNELS);
+    while (done < len && valid_digits < NUM_CHANNELS) {
+        n = min(len - done, sizeof(chunk));
+        if (copy_from_user(chunk, buffer + done, n)) {
+            return -EFAULT;
+        }
+        done += n;
+        valid_digits = dsim_parse_digits(chunk, n, states, NULL, valid_digits, NUM_CHANNELS);
     }
-    user_input[len] = '\0';
     
     mutex_lock(&dev->state_mutex);
+    memcpy(dev->output_states, states, NUM_CHANNELS);
+    mutex_unlock(&dev->state_mutex);
     
-    // initialize all output channels to '0'
-    memset(dev->output_states, '0', NUM_CHANNELS);
-    
-    // process input, only accepting '0' and '1'
-    for (i = 0; i < len && valid_digits < NUM_CHANNELS; i++) {
-        if (user_input[i] == '0' || user_input[i] == '1') {
-            dev->output_states[valid_digits] = user_input[i];
-            valid_digits++;
-        } else if (user_input[i] == '\n' || user_input[i] == '\r') {
-            continue;
-        }
+    if (trace_phidgetvintx6_write_enabled()) {
+        trace_phidgetvintx6_write(dev->device_id, channel_states_to_bits(states), len);
     }
     
-    mutex_unlock(&dev->state_mutex);
-    
     dbg_dev_info(2, dev->device_id, "Updated output states: %.6s (from %d valid digits)\n", 
-                 dev->output_states, valid_digits);
+                 states, valid_digits);
     
-    kfree(user_input);
     return len;
 }
 
@@ -463,9 +496,9 @@ static unsigned int dev_poll(struct file *filep, struct poll_table_struct *wait)
         return POLLERR;
     }
 
-    poll_wait(filep, &reader->wait, wait);
+    poll_wait(filep, &reader->device->notify.wait, wait);
 
-    if (reader->state_changed) {
+    if (reader_has_data(reader)) {
         mask |= POLLIN | POLLRDNORM;
     }
 
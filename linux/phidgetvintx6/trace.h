@@ -0,0 +1,98 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM phidgetvintx6
+
+#if !defined(_PHIDGETVINTX6_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _PHIDGETVINTX6_TRACE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(phidgetvintx6_file,
+    TP_PROTO(int minor),
+    TP_ARGS(minor),
+    TP_STRUCT__entry(
+        __field(int, minor)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+    ),
+    TP_printk("minor=%d", __entry->minor)
+);
+
+DEFINE_EVENT(phidgetvintx6_file, phidgetvintx6_open,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+DEFINE_EVENT(phidgetvintx6_file, phidgetvintx6_release,
+    TP_PROTO(int minor),
+    TP_ARGS(minor)
+);
+
+// state is the input state read or the output state written, bytes the
+// length of the call
+DECLARE_EVENT_CLASS(phidgetvintx6_io,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, state)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d state=%02x bytes=%zu", __entry->minor, __entry->state, __entry->bytes)
+);
+
+DEFINE_EVENT(phidgetvintx6_io, phidgetvintx6_read,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes)
+);
+
+DEFINE_EVENT(phidgetvintx6_io, phidgetvintx6_write,
+    TP_PROTO(int minor, u32 state, size_t bytes),
+    TP_ARGS(minor, state, bytes)
+);
+
+TRACE_EVENT(phidgetvintx6_state_change,
+    TP_PROTO(int minor, u32 old_state, u32 new_state, u64 generation),
+    TP_ARGS(minor, old_state, new_state, generation),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u32, old_state)
+        __field(u32, new_state)
+        __field(u64, generation)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->old_state = old_state;
+        __entry->new_state = new_state;
+        __entry->generation = generation;
+    ),
+    TP_printk("minor=%d state=%02x->%02x generation=%llu", __entry->minor,
+              __entry->old_state, __entry->new_state, __entry->generation)
+);
+
+// a blocked reader returned from its wait
+TRACE_EVENT(phidgetvintx6_wakeup,
+    TP_PROTO(int minor, u64 generation),
+    TP_ARGS(minor, generation),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u64, generation)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->generation = generation;
+    ),
+    TP_printk("minor=%d generation=%llu", __entry->minor, __entry->generation)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
@@ -0,0 +1,942 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/version.h>
+#include <linux/device.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/idr.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/bitmap.h>
+#include <linux/firmware.h>
+#include <linux/percpu.h>
+
+#include "domiot-sim.h"
+#include "plc-sim.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
+#define DEVICE_NAME "plc-sim"
+#define CLASS_NAME "plc"
+#define MAX_DEVICES 1024
+#define MIN_SCAN_PERIOD_US 10ULL
+#define MAX_SCAN_PERIOD_US (60ULL * USEC_PER_SEC)
+#define PROGRAM_NAME_SIZE 64
+
+// debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
+static int debug_level = 1;
+module_param(debug_level, int, 0644);
+MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
+
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the plc parameter of domiot-sim.ko
+extern int domiot_sim_plc;
+#define num_devices domiot_sim_plc
+#else
+static int num_devices = 1;
+module_param(num_devices, int, S_IRUGO);
+MODULE_PARM_DESC(num_devices, "Number of plc-sim devices to create at load time (default: 1, max: 1024)");
+#endif
+
+static unsigned long long scan_period_us = 1000;
+module_param(scan_period_us, ullong, S_IRUGO);
+MODULE_PARM_DESC(scan_period_us, "Initial scan period in microseconds (default: 1000, min: 10, max: 60000000)");
+
+// operation counters, the stats attributes sum them over all CPUs
+struct plc_stats {
+    u64 scans;
+    u64 scan_ns;        // total execution time of all scans
+    u64 overruns;       // scans that did not finish within the period
+    u64 writes;         // output updates sent to the simulators
+    u64 io_errors;      // reads or writes of a device that does not exist
+};
+
+// a device used by the program, read at the start of the scan and written
+// back at the end if the program changed it
+struct plc_io {
+    u8 area;
+    u16 minor;
+    u32 in;
+    u32 out;
+};
+
+// instruction checked and resolved at load time
+struct plc_op {
+    u8 op;
+    u8 area;
+    u8 io;              // index in ios in the device areas
+    u16 index;
+    u64 preset_ns;
+};
+
+struct plc_program {
+    struct plc_op *ops;
+    u32 count;
+    struct plc_io ios[PLC_MAX_IO_DEVICES];
+    unsigned int num_ios;
+    // functions of the simulator modules the program uses, the modules are
+    // kept loaded until the program is unloaded
+    int (*get_inputs)(int, u32 *);
+    int (*get_channels)(int, u32 *);
+    int (*set_channels)(int, u32, u32);
+    int (*set_outputs)(int, u32);
+};
+
+struct plc_timer {
+    u64 start_ns;
+    bool in;
+    bool q;
+};
+
+struct plc_device {
+    int minor;
+    struct device *device;
+    // serializes sysfs control of the program and the scan thread, the
+    // program only changes while the thread is stopped
+    struct mutex control_mutex;
+    struct plc_program *program;
+    char program_name[PROGRAM_NAME_SIZE];
+    struct task_struct *thread;
+    u64 period_ns;
+    // program state, only used by the scan thread
+    DECLARE_BITMAP(markers, PLC_NUM_MARKERS);
+    struct plc_timer timers[PLC_NUM_TIMERS];
+    // execution time of the last and the longest scan
+    u64 last_scan_ns;
+    u64 max_scan_ns;
+    struct plc_stats __percpu *stats;
+};
+
+static struct class *plc_class = NULL;
+// devices by number, devices_mutex protects the table
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
+
+static ssize_t program_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t program_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t control_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t control_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t scan_period_us_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t scan_period_us_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t scan_time_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t scan_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+
+static DEVICE_ATTR(program, 0664, program_show, program_store);
+static DEVICE_ATTR(control, 0664, control_show, control_store);
+static DEVICE_ATTR(scan_period_us, 0664, scan_period_us_show, scan_period_us_store);
+static DEVICE_ATTR(scan_time, 0664, scan_time_show, scan_time_store);
+
+static struct attribute *plc_attrs[] = {
+    &dev_attr_program.attr,
+    &dev_attr_control.attr,
+    &dev_attr_scan_period_us.attr,
+    &dev_attr_scan_time.attr,
+    NULL,
+};
+
+static const struct attribute_group plc_attr_group = {
+    .attrs = plc_attrs,
+};
+
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct plc_device, struct plc_stats, field)
+
+STATS_ATTR(scans);
+STATS_ATTR(scan_ns);
+STATS_ATTR(overruns);
+STATS_ATTR(writes);
+STATS_ATTR(io_errors);
+
+static struct attribute *plc_stats_attrs[] = {
+    &dev_attr_stats_scans.attr,
+    &dev_attr_stats_scan_ns.attr,
+    &dev_attr_stats_overruns.attr,
+    &dev_attr_stats_writes.attr,
+    &dev_attr_stats_io_errors.attr,
+    NULL,
+};
+
+// /sys/class/plc/plc-simN/stats/
+static const struct attribute_group plc_stats_group = {
+    .name = "stats",
+    .attrs = plc_stats_attrs,
+};
+
+static const struct attribute_group *plc_attr_groups[] = {
+    &plc_attr_group,
+    &plc_stats_group,
+    NULL,
+};
+
+static bool plc_read(struct plc_device *plc, struct plc_program *prog, const struct plc_op *op)
+{
+    switch (op->area) {
+    case PLC_AREA_MARKER:
+        return test_bit(op->index, plc->markers);
+    case PLC_AREA_TIMER:
+        return plc->timers[op->index].q;
+    default:
+        // outputs written earlier in the scan are read back
+        return prog->ios[op->io].out & BIT(op->index);
+    }
+}
+
+static void plc_write(struct plc_device *plc, struct plc_program *prog, const struct plc_op *op, bool value)
+{
+    struct plc_io *io;
+
+    if (op->area == PLC_AREA_MARKER) {
+        __assign_bit(op->index, plc->markers, value);
+        return;
+    }
+    io = &prog->ios[op->io];
+    if (value) {
+        io->out |= BIT(op->index);
+    } else {
+        io->out &= ~BIT(op->index);
+    }
+}
+
+// on delay: the output follows the input once it has been on for the preset
+static bool timer_on_delay(struct plc_timer *t, bool in, u64 preset_ns, u64 now)
+{
+    if (!in) {
+        t->in = false;
+        t->q = false;
+    } else {
+        if (!t->in) {
+            t->in = true;
+            t->start_ns = now;
+        }
+        if (now - t->start_ns >= preset_ns) {
+            t->q = true;
+        }
+    }
+    return t->q;
+}
+
+// off delay: the output turns on with the input and off once the input has
+// been off for the preset
+static bool timer_off_delay(struct plc_timer *t, bool in, u64 preset_ns, u64 now)
+{
+    if (in) {
+        t->in = true;
+        t->q = true;
+    } else {
+        if (t->in) {
+            t->in = false;
+            t->start_ns = now;
+        }
+        if (t->q && now - t->start_ns >= preset_ns) {
+            t->q = false;
+        }
+    }
+    return t->q;
+}
+
+// read the input image, run the program once and write the changed outputs
+static void plc_scan(struct plc_device *plc)
+{
+    struct plc_program *prog = plc->program;
+    bool stack[PLC_STACK_DEPTH];
+    const struct plc_op *op;
+    struct plc_io *io;
+    unsigned int writes = 0;
+    int sp = 0, ret;
+    bool rlo = false;
+    u64 start, elapsed;
+    u32 i;
+
+    start = ktime_get_ns();
+
+    for (i = 0; i < prog->num_ios; i++) {
+        io = &prog->ios[i];
+        ret = 0;
+        if (io->area == PLC_AREA_IHUB) {
+            ret = prog->get_inputs(io->minor, &io->in);
+        } else if (io->area == PLC_AREA_IOHUB) {
+            ret = prog->get_channels(io->minor, &io->in);
+        }
+        // ohubx24 outputs cannot be read, in keeps the last image written
+        if (ret) {
+            this_cpu_inc(plc->stats->io_errors);
+        }
+        io->out = io->in;
+    }
+
+    // the stack depth was checked when the program was loaded
+    for (i = 0; i < prog->count; i++) {
+        op = &prog->ops[i];
+        switch (op->op) {
+        case PLC_OP_LD:
+            rlo = plc_read(plc, prog, op);
+            break;
+        case PLC_OP_LDN:
+            rlo = !plc_read(plc, prog, op);
+            break;
+        case PLC_OP_AND:
+            rlo = rlo && plc_read(plc, prog, op);
+            break;
+        case PLC_OP_ANDN:
+            rlo = rlo && !plc_read(plc, prog, op);
+            break;
+        case PLC_OP_OR:
+            rlo = rlo || plc_read(plc, prog, op);
+            break;
+        case PLC_OP_ORN:
+            rlo = rlo || !plc_read(plc, prog, op);
+            break;
+        case PLC_OP_NOT:
+            rlo = !rlo;
+            break;
+        case PLC_OP_PUSH:
+            stack[sp++] = rlo;
+            break;
+        case PLC_OP_ANDP:
+            rlo = stack[--sp] && rlo;
+            break;
+        case PLC_OP_ORP:
+            rlo = stack[--sp] || rlo;
+            break;
+        case PLC_OP_ST:
+            plc_write(plc, prog, op, rlo);
+            break;
+        case PLC_OP_SET:
+            if (rlo) {
+                plc_write(plc, prog, op, true);
+            }
+            break;
+        case PLC_OP_RST:
+            if (rlo) {
+                plc_write(plc, prog, op, false);
+            }
+            break;
+        case PLC_OP_TON:
+            rlo = timer_on_delay(&plc->timers[op->index], rlo, op->preset_ns, start);
+            break;
+        case PLC_OP_TOF:
+            rlo = timer_off_delay(&plc->timers[op->index], rlo, op->preset_ns, start);
+            break;
+        }
+    }
+
+    for (i = 0; i < prog->num_ios; i++) {
+        io = &prog->ios[i];
+        if (io->out == io->in) {
+            continue;
+        }
+        // only the channels the program changed, the others may have been
+        // written by someone else since the scan started
+        if (io->area == PLC_AREA_IOHUB) {
+            ret = prog->set_channels(io->minor, io->in ^ io->out, io->out);
+        } else {
+            ret = prog->set_outputs(io->minor, io->out);
+            if (!ret) {
+                io->in = io->out;
+            }
+        }
+        if (ret) {
+            this_cpu_inc(plc->stats->io_errors);
+        } else {
+            writes++;
+        }
+    }
+
+    elapsed = ktime_get_ns() - start;
+    WRITE_ONCE(plc->last_scan_ns, elapsed);
+    if (elapsed > READ_ONCE(plc->max_scan_ns)) {
+        WRITE_ONCE(plc->max_scan_ns, elapsed);
+    }
+    this_cpu_inc(plc->stats->scans);
+    this_cpu_add(plc->stats->scan_ns, elapsed);
+    this_cpu_add(plc->stats->writes, writes);
+    trace_plc_sim_scan(plc->minor, elapsed, writes);
+}
+
+// scans are started on a fixed period from the first one, so that timers
+// and readers of the outputs see a steady cycle; after an overrun the cycle
+// restarts a full period after the late scan, instead of scanning again
+// right away
+static int plc_thread(void *data)
+{
+    struct plc_device *plc = data;
+    ktime_t next = ktime_get();
+    ktime_t now;
+    u64 period_ns;
+
+    while (!kthread_should_stop()) {
+        plc_scan(plc);
+
+        period_ns = READ_ONCE(plc->period_ns);
+        next = ktime_add_ns(next, period_ns);
+        now = ktime_get();
+        if (ktime_before(next, now)) {
+            this_cpu_inc(plc->stats->overruns);
+            next = ktime_add_ns(now, period_ns);
+        }
+
+        set_current_state(TASK_INTERRUPTIBLE);
+        if (!kthread_should_stop()) {
+            schedule_hrtimeout_range(&next, 0, HRTIMER_MODE_ABS);
+        }
+        __set_current_state(TASK_RUNNING);
+    }
+    return 0;
+}
+
+// caller holds control_mutex
+static void plc_stop(struct plc_device *plc)
+{
+    if (plc->thread) {
+        kthread_stop(plc->thread);
+        plc->thread = NULL;
+        dbg_dev_info(2, plc->minor, "Stopped\n");
+    }
+}
+
+static void program_free(struct plc_program *prog)
+{
+    if (prog->get_inputs) {
+        dsim_symbol_put(ihubx24_sim_get_inputs);
+    }
+    if (prog->get_channels) {
+        dsim_symbol_put(iohubx24_sim_get_channels);
+    }
+    if (prog->set_channels) {
+        dsim_symbol_put(iohubx24_sim_set_channels);
+    }
+    if (prog->set_outputs) {
+        dsim_symbol_put(ohubx24_sim_set_outputs);
+    }
+    kvfree(prog->ops);
+    kfree(prog);
+}
+
+// slot of the device in the program's I/O table, added on first use
+static int program_io(struct plc_program *prog, u8 area, u16 minor)
+{
+    unsigned int i;
+
+    for (i = 0; i < prog->num_ios; i++) {
+        if (prog->ios[i].area == area && prog->ios[i].minor == minor) {
+            return i;
+        }
+    }
+    if (prog->num_ios == PLC_MAX_IO_DEVICES) {
+        return -E2BIG;
+    }
+    prog->ios[i].area = area;
+    prog->ios[i].minor = minor;
+    prog->num_ios++;
+    return i;
+}
+
+// check one instruction and resolve its operand, depth tracks the stack
+static int compile_insn(struct plc_program *prog, const struct plc_insn *insn, struct plc_op *op, int *depth)
+{
+    u16 minor = le16_to_cpu(insn->minor);
+    int io;
+
+    op->op = insn->op;
+    op->area = insn->area;
+    op->index = le16_to_cpu(insn->index);
+    op->preset_ns = (u64)le32_to_cpu(insn->preset_us) * NSEC_PER_USEC;
+
+    switch (op->op) {
+    case PLC_OP_LD:
+    case PLC_OP_LDN:
+    case PLC_OP_AND:
+    case PLC_OP_ANDN:
+    case PLC_OP_OR:
+    case PLC_OP_ORN:
+        if (op->area == PLC_AREA_NONE || op->area > PLC_AREA_TIMER) return -EINVAL;
+        break;
+    case PLC_OP_ST:
+    case PLC_OP_SET:
+    case PLC_OP_RST:
+        if (op->area != PLC_AREA_IOHUB && op->area != PLC_AREA_OHUB && op->area != PLC_AREA_MARKER) return -EINVAL;
+        break;
+    case PLC_OP_TON:
+    case PLC_OP_TOF:
+        if (op->area != PLC_AREA_TIMER) return -EINVAL;
+        break;
+    case PLC_OP_PUSH:
+        if (op->area != PLC_AREA_NONE || ++(*depth) > PLC_STACK_DEPTH) return -EINVAL;
+        return 0;
+    case PLC_OP_ANDP:
+    case PLC_OP_ORP:
+        if (op->area != PLC_AREA_NONE || --(*depth) < 0) return -EINVAL;
+        return 0;
+    case PLC_OP_NOT:
+        return op->area == PLC_AREA_NONE ? 0 : -EINVAL;
+    default:
+        return -EINVAL;
+    }
+
+    switch (op->area) {
+    case PLC_AREA_MARKER:
+        return op->index < PLC_NUM_MARKERS ? 0 : -EINVAL;
+    case PLC_AREA_TIMER:
+        return op->index < PLC_NUM_TIMERS ? 0 : -EINVAL;
+    }
+
+    if (op->index >= PLC_NUM_CHANNELS || minor >= MAX_DEVICES) return -EINVAL;
+    io = program_io(prog, op->area, minor);
+    if (io < 0) return io;
+    op->io = io;
+    return 0;
+}
+
+// find the functions of the simulators the program uses, their modules
+// must be loaded
+static int program_link(struct plc_program *prog)
+{
+    unsigned int i;
+
+    for (i = 0; i < prog->num_ios; i++) {
+        switch (prog->ios[i].area) {
+        case PLC_AREA_IHUB:
+            if (!prog->get_inputs && !(prog->get_inputs = dsim_symbol_get(ihubx24_sim_get_inputs))) {
+                dbg_err("ihubx24-sim is not loaded\n");
+                return -ENOENT;
+            }
+            break;
+        case PLC_AREA_IOHUB:
+            if (!prog->get_channels && !(prog->get_channels = dsim_symbol_get(iohubx24_sim_get_channels))) {
+                dbg_err("iohubx24-sim is not loaded\n");
+                return -ENOENT;
+            }
+            if (!prog->set_channels && !(prog->set_channels = dsim_symbol_get(iohubx24_sim_set_channels))) {
+                dbg_err("iohubx24-sim is not loaded\n");
+                return -ENOENT;
+            }
+            break;
+        case PLC_AREA_OHUB:
+            if (!prog->set_outputs && !(prog->set_outputs = dsim_symbol_get(ohubx24_sim_set_outputs))) {
+                dbg_err("ohubx24-sim is not loaded\n");
+                return -ENOENT;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+static struct plc_program *program_load(const struct firmware *fw)
+{
+    const struct plc_program_header *header = (const struct plc_program_header *)fw->data;
+    const struct plc_insn *insns;
+    struct plc_program *prog;
+    int depth = 0, ret;
+    u32 count, i;
+
+    count = fw->size >= sizeof(*header) ? le32_to_cpu(header->count) : 0;
+    if (fw->size < sizeof(*header) || le32_to_cpu(header->magic) != PLC_PROGRAM_MAGIC ||
+        count == 0 || count > PLC_MAX_INSNS ||
+        fw->size - sizeof(*header) != (size_t)count * sizeof(struct plc_insn)) {
+        return ERR_PTR(-EINVAL);
+    }
+    insns = (const struct plc_insn *)(fw->data + sizeof(*header));
+
+    prog = kzalloc(sizeof(*prog), GFP_KERNEL);
+    if (!prog) {
+        return ERR_PTR(-ENOMEM);
+    }
+    prog->ops = kvcalloc(count, sizeof(struct plc_op), GFP_KERNEL);
+    if (!prog->ops) {
+        kfree(prog);
+        return ERR_PTR(-ENOMEM);
+    }
+    prog->count = count;
+
+    for (i = 0; i < count; i++) {
+        ret = compile_insn(prog, &insns[i], &prog->ops[i], &depth);
+        if (ret) {
+            dbg_err("Invalid instruction %u\n", i);
+            goto fail;
+        }
+    }
+
+    ret = program_link(prog);
+    if (ret) {
+        goto fail;
+    }
+    return prog;
+
+fail:
+    program_free(prog);
+    return ERR_PTR(ret);
+}
+
+static ssize_t program_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    ssize_t ret;
+
+    if (!plc) return -ENODEV;
+
+    mutex_lock(&plc->control_mutex);
+    ret = sprintf(buf, "%s\n", plc->program_name);
+    mutex_unlock(&plc->control_mutex);
+    return ret;
+}
+
+// load a program with request_firmware(), "none" unloads it; the scan must
+// be stopped
+static ssize_t program_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    struct plc_program *prog = NULL;
+    const struct firmware *fw;
+    char line[PROGRAM_NAME_SIZE];
+    char *name;
+    int ret;
+
+    if (!plc) return -ENODEV;
+
+    if (strscpy(line, buf, sizeof(line)) < 0) return -EINVAL;
+    // strim() drops leading blanks by returning a pointer past them
+    name = strim(line);
+
+    if (name[0] != '\0' && strcmp(name, "none") != 0) {
+        ret = request_firmware(&fw, name, dev);
+        if (ret) {
+            dbg_err("Failed to load program %s (%d)\n", name, ret);
+            return ret;
+        }
+        prog = program_load(fw);
+        release_firmware(fw);
+        if (IS_ERR(prog)) {
+            dbg_err("Invalid program %s\n", name);
+            return PTR_ERR(prog);
+        }
+    }
+
+    mutex_lock(&plc->control_mutex);
+    if (plc->thread) {
+        mutex_unlock(&plc->control_mutex);
+        if (prog) {
+            program_free(prog);
+        }
+        return -EBUSY;
+    }
+    if (plc->program) {
+        program_free(plc->program);
+    }
+    plc->program = prog;
+    strscpy(plc->program_name, prog ? name : "none", sizeof(plc->program_name));
+    // a new program starts from cleared markers and timers
+    bitmap_zero(plc->markers, PLC_NUM_MARKERS);
+    memset(plc->timers, 0, sizeof(plc->timers));
+    mutex_unlock(&plc->control_mutex);
+
+    trace_plc_sim_program(plc->minor, prog ? prog->count : 0);
+    dbg_dev_info(2, plc->minor, "Program %s loaded (%u instructions)\n", name, prog ? prog->count : 0);
+    return count;
+}
+
+static ssize_t control_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    ssize_t ret;
+
+    if (!plc) return -ENODEV;
+
+    mutex_lock(&plc->control_mutex);
+    ret = sprintf(buf, "%s\n", plc->thread ? "run" : "stop");
+    mutex_unlock(&plc->control_mutex);
+    return ret;
+}
+
+// "run" starts scanning the loaded program, "stop" ends the scan; outputs
+// keep their last state
+static ssize_t control_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    struct task_struct *thread;
+    int ret = 0;
+
+    if (!plc) return -ENODEV;
+
+    mutex_lock(&plc->control_mutex);
+    if (sysfs_streq(buf, "run")) {
+        if (!plc->program) {
+            ret = -ENOENT;
+        } else if (!plc->thread) {
+            thread = kthread_run(plc_thread, plc, "plc-sim%d", plc->minor);
+            if (IS_ERR(thread)) {
+                ret = PTR_ERR(thread);
+            } else {
+                plc->thread = thread;
+                dbg_dev_info(2, plc->minor, "Running %s\n", plc->program_name);
+            }
+        }
+    } else if (sysfs_streq(buf, "stop")) {
+        plc_stop(plc);
+    } else {
+        ret = -EINVAL;
+    }
+    mutex_unlock(&plc->control_mutex);
+
+    return ret ? ret : count;
+}
+
+static ssize_t scan_period_us_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    if (!plc) return -ENODEV;
+
+    return sprintf(buf, "%llu\n", div_u64(READ_ONCE(plc->period_ns), NSEC_PER_USEC));
+}
+
+// applies from the next scan
+static ssize_t scan_period_us_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    unsigned long long value;
+    int ret;
+
+    if (!plc) return -ENODEV;
+
+    ret = kstrtoull(buf, 10, &value);
+    if (ret) return ret;
+    if (value < MIN_SCAN_PERIOD_US || value > MAX_SCAN_PERIOD_US) return -EINVAL;
+
+    WRITE_ONCE(plc->period_ns, value * NSEC_PER_USEC);
+    dbg_dev_info(2, plc->minor, "Scan period set to %llu us\n", value);
+    return count;
+}
+
+// execution time of the last scan, the longest one and the average
+static ssize_t scan_time_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+    u64 scans, total;
+
+    if (!plc) return -ENODEV;
+
+    scans = dsim_stats_sum(plc->stats, offsetof(struct plc_stats, scans));
+    total = dsim_stats_sum(plc->stats, offsetof(struct plc_stats, scan_ns));
+    return sprintf(buf, "%llu ns last, %llu ns max, %llu ns avg\n", READ_ONCE(plc->last_scan_ns),
+                   READ_ONCE(plc->max_scan_ns), scans ? div64_u64(total, scans) : 0);
+}
+
+// writing 0 restarts the maximum
+static ssize_t scan_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct plc_device *plc = dev_get_drvdata(dev);
+
+    if (!plc) return -ENODEV;
+    if (!sysfs_streq(buf, "0")) return -EINVAL;
+
+    WRITE_ONCE(plc->max_scan_ns, 0);
+    return count;
+}
+
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct plc_device *plc;
+    int result;
+
+    plc = kzalloc(sizeof(struct plc_device), GFP_KERNEL);
+    if (!plc) {
+        return -ENOMEM;
+    }
+
+    plc->stats = alloc_percpu(struct plc_stats);
+    if (!plc->stats) {
+        kfree(plc);
+        return -ENOMEM;
+    }
+
+    result = idr_alloc(&devices_idr, plc, id, id + 1, GFP_KERNEL);
+    if (result < 0) {
+        free_percpu(plc->stats);
+        kfree(plc);
+        return result == -ENOSPC ? -EEXIST : result;
+    }
+
+    plc->minor = id;
+    plc->period_ns = scan_period_us * NSEC_PER_USEC;
+    mutex_init(&plc->control_mutex);
+    strscpy(plc->program_name, "none", sizeof(plc->program_name));
+
+    // no character device, the PLC is controlled through sysfs only
+    plc->device = device_create(plc_class, NULL, 0, plc, DEVICE_NAME "%d", id);
+    if (IS_ERR(plc->device)) {
+        dbg_err("Failed to create device %d\n", id);
+        result = PTR_ERR(plc->device);
+        goto cleanup_dev;
+    }
+
+    result = sysfs_create_groups(&plc->device->kobj, plc_attr_groups);
+    if (result) {
+        dbg_err("Failed to create sysfs attributes for device %d\n", id);
+        device_unregister(plc->device);
+        goto cleanup_dev;
+    }
+
+    dbg_dev_info(1, id, "Device created correctly\n");
+    return 0;
+
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&plc->control_mutex);
+    free_percpu(plc->stats);
+    kfree(plc);
+    return result;
+}
+
+// caller holds devices_mutex
+static void destroy_device(struct plc_device *plc)
+{
+    int id = plc->minor;
+
+    sysfs_remove_groups(&plc->device->kobj, plc_attr_groups);
+    device_unregister(plc->device);
+
+    // no sysfs writer is left, stop the scan and release the modules it uses
+    plc_stop(plc);
+    if (plc->program) {
+        program_free(plc->program);
+    }
+    mutex_destroy(&plc->control_mutex);
+    idr_remove(&devices_idr, id);
+    free_percpu(plc->stats);
+    kfree(plc);
+
+    dbg_dev_info(1, id, "Device removed\n");
+}
+
+static void destroy_all_devices(void)
+{
+    struct plc_device *plc;
+    int id;
+
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, plc, id) {
+        destroy_device(plc);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/plc/new_device creates plc-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+
+    return ret ? ret : count;
+}
+
+// echo N > /sys/class/plc/delete_device stops and removes plc-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct plc_device *plc;
+    int id, ret;
+
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+
+    mutex_lock(&devices_mutex);
+    plc = idr_find(&devices_idr, id);
+    if (!plc) {
+        ret = -ENODEV;
+    } else {
+        destroy_device(plc);
+    }
+    mutex_unlock(&devices_mutex);
+
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
+static int __init plc_init(void)
+{
+    int i, result;
+
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
+        dbg_err("Invalid number of devices: %d (must be 0-%d)\n", num_devices, MAX_DEVICES);
+        return -EINVAL;
+    }
+
+    if (scan_period_us < MIN_SCAN_PERIOD_US || scan_period_us > MAX_SCAN_PERIOD_US) {
+        dbg_err("Invalid scan_period_us (%llu). Must be %llu-%llu\n", scan_period_us,
+                MIN_SCAN_PERIOD_US, MAX_SCAN_PERIOD_US);
+        return -EINVAL;
+    }
+
+    dbg_info(1, "Initializing %d PLC device(s)\n", num_devices);
+
+    plc_class = CLASS_CREATE_COMPAT(CLASS_NAME);
+    if (IS_ERR(plc_class)) {
+        dbg_err("Failed to create device class\n");
+        return PTR_ERR(plc_class);
+    }
+
+    // create the initial devices, more can be added through new_device
+    result = 0;
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices && !result; i++) {
+        result = create_device(i);
+    }
+    mutex_unlock(&devices_mutex);
+    if (result) {
+        goto cleanup_devices;
+    }
+
+    result = class_create_file(plc_class, &class_attr_new_device);
+    if (result) {
+        goto cleanup_devices;
+    }
+    result = class_create_file(plc_class, &class_attr_delete_device);
+    if (result) {
+        class_remove_file(plc_class, &class_attr_new_device);
+        goto cleanup_devices;
+    }
+
+    dbg_info(1, "Module loaded successfully\n");
+    return 0;
+
+cleanup_devices:
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
+    class_destroy(plc_class);
+    return result;
+}
+
+static void __dsim_exit plc_exit(void)
+{
+    dbg_info(1, "Unloading PLC module\n");
+
+    class_remove_file(plc_class, &class_attr_delete_device);
+    class_remove_file(plc_class, &class_attr_new_device);
+
+    destroy_all_devices();
+    idr_destroy(&devices_idr);
+    class_destroy(plc_class);
+
+    dbg_info(1, "PLC module unloaded successfully\n");
+}
+
+DSIM_MODULE(plc, plc_init, plc_exit)
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("DOMIoT");
+MODULE_DESCRIPTION("PLC scan engine driving the DOMIoT simulators");
+MODULE_VERSION("1.0.0");
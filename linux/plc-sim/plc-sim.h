@@ -0,0 +1,58 @@
+#ifndef _PLC_SIM_H
+#define _PLC_SIM_H
+
+#include <linux/types.h>
+
+// Program run by plc-sim: a header followed by count instructions, all
+// fields little-endian. Like a PLC instruction list, the instructions work
+// on one bit, the result of logic operation (RLO), and nested expressions
+// keep partial results on a small stack.
+#define PLC_PROGRAM_MAGIC 0x31434c50    // "PLC1"
+#define PLC_MAX_INSNS 4096
+
+struct plc_program_header {
+    __le32 magic;
+    __le32 count;
+};
+
+struct plc_insn {
+    __u8 op;
+    __u8 area;              // operand area, PLC_AREA_NONE for NOT, PUSH, ANDP and ORP
+    __le16 minor;           // device minor in the device areas
+    __le16 index;           // channel, marker or timer number
+    __le16 reserved;
+    __le32 preset_us;       // TON and TOF only
+} __attribute__((packed));
+
+// operations
+#define PLC_OP_LD   1       // RLO = operand
+#define PLC_OP_LDN  2       // RLO = !operand
+#define PLC_OP_AND  3       // RLO = RLO & operand
+#define PLC_OP_ANDN 4       // RLO = RLO & !operand
+#define PLC_OP_OR   5       // RLO = RLO | operand
+#define PLC_OP_ORN  6       // RLO = RLO | !operand
+#define PLC_OP_NOT  7       // RLO = !RLO
+#define PLC_OP_PUSH 8       // push RLO
+#define PLC_OP_ANDP 9       // RLO = pop & RLO
+#define PLC_OP_ORP  10      // RLO = pop | RLO
+#define PLC_OP_ST   11      // operand = RLO
+#define PLC_OP_SET  12      // operand = 1 if RLO, latches until reset
+#define PLC_OP_RST  13      // operand = 0 if RLO
+#define PLC_OP_TON  14      // on delay: RLO is the timer input, then its output
+#define PLC_OP_TOF  15      // off delay: RLO is the timer input, then its output
+
+// operand areas
+#define PLC_AREA_NONE   0
+#define PLC_AREA_IHUB   1   // ihubx24-simN input, read only
+#define PLC_AREA_IOHUB  2   // iohubx24-simN channel
+#define PLC_AREA_OHUB   3   // ohubx24-simN output
+#define PLC_AREA_MARKER 4   // internal bit
+#define PLC_AREA_TIMER  5   // timer output, read only
+
+#define PLC_NUM_CHANNELS 24
+#define PLC_NUM_MARKERS 256
+#define PLC_NUM_TIMERS 64
+#define PLC_MAX_IO_DEVICES 16   // distinct devices used by one program
+#define PLC_STACK_DEPTH 16
+
+#endif
@@ -0,0 +1,46 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM plc_sim
+
+#if !defined(_PLC_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _PLC_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// one event per scan, writes is the number of devices whose outputs changed
+TRACE_EVENT(plc_sim_scan,
+    TP_PROTO(int minor, u64 scan_ns, unsigned int writes),
+    TP_ARGS(minor, scan_ns, writes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(u64, scan_ns)
+        __field(unsigned int, writes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->scan_ns = scan_ns;
+        __entry->writes = writes;
+    ),
+    TP_printk("minor=%d scan_ns=%llu writes=%u", __entry->minor, __entry->scan_ns, __entry->writes)
+);
+
+// a program of count instructions was loaded, 0 when it was unloaded
+TRACE_EVENT(plc_sim_program,
+    TP_PROTO(int minor, unsigned int count),
+    TP_ARGS(minor, count),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(unsigned int, count)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->count = count;
+    ),
+    TP_printk("minor=%d insns=%u", __entry->minor, __entry->count)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
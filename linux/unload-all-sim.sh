@@ -1,6 +1,8 @@
 #!/bin/bash
 
-cd ihubx24-sim
+cd plc-sim
+make unload
+cd ../ihubx24-sim
 make unload
 cd ../ohubx24-sim
 make unload
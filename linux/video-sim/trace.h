@@ -0,0 +1,133 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM video_sim
+
+#if !defined(_VIDEO_SIM_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _VIDEO_SIM_TRACE_H
+
+#include <linux/tracepoint.h>
+
+#define VIDEO_SIM_PLAY_TIMER 0
+#define VIDEO_SIM_TIME_UPDATE_TIMER 1
+
+#define show_video_state(state) __print_symbolic(state, \
+    { 0, "stopped" }, { 1, "playing" }, { 2, "paused" })
+
+DECLARE_EVENT_CLASS(video_sim_file,
+    TP_PROTO(int minor, bool reader),
+    TP_ARGS(minor, reader),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(bool, reader)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->reader = reader;
+    ),
+    TP_printk("minor=%d reader=%d", __entry->minor, __entry->reader)
+);
+
+DEFINE_EVENT(video_sim_file, video_sim_open,
+    TP_PROTO(int minor, bool reader),
+    TP_ARGS(minor, reader)
+);
+
+DEFINE_EVENT(video_sim_file, video_sim_release,
+    TP_PROTO(int minor, bool reader),
+    TP_ARGS(minor, reader)
+);
+
+// position is the playback position returned, bytes the length of the message
+TRACE_EVENT(video_sim_read,
+    TP_PROTO(int minor, unsigned long position_ms, size_t bytes),
+    TP_ARGS(minor, position_ms, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(unsigned long, position_ms)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->position_ms = position_ms;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d position_ms=%lu bytes=%zu", __entry->minor, __entry->position_ms, __entry->bytes)
+);
+
+// state is the playback state after the command
+TRACE_EVENT(video_sim_write,
+    TP_PROTO(int minor, int state, size_t bytes),
+    TP_ARGS(minor, state, bytes),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(int, state)
+        __field(size_t, bytes)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->state = state;
+        __entry->bytes = bytes;
+    ),
+    TP_printk("minor=%d state=%s bytes=%zu", __entry->minor, show_video_state(__entry->state), __entry->bytes)
+);
+
+TRACE_EVENT(video_sim_state_change,
+    TP_PROTO(int minor, int old_state, int new_state, unsigned long position_ms),
+    TP_ARGS(minor, old_state, new_state, position_ms),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(int, old_state)
+        __field(int, new_state)
+        __field(unsigned long, position_ms)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->old_state = old_state;
+        __entry->new_state = new_state;
+        __entry->position_ms = position_ms;
+    ),
+    TP_printk("minor=%d state=%s->%s position_ms=%lu", __entry->minor,
+              show_video_state(__entry->old_state), show_video_state(__entry->new_state),
+              __entry->position_ms)
+);
+
+// a blocked reader returned from its wait
+TRACE_EVENT(video_sim_wakeup,
+    TP_PROTO(int minor, unsigned long position_ms),
+    TP_ARGS(minor, position_ms),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(unsigned long, position_ms)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->position_ms = position_ms;
+    ),
+    TP_printk("minor=%d position_ms=%lu", __entry->minor, __entry->position_ms)
+);
+
+TRACE_EVENT(video_sim_timer,
+    TP_PROTO(int minor, int timer, int state, unsigned long position_ms),
+    TP_ARGS(minor, timer, state, position_ms),
+    TP_STRUCT__entry(
+        __field(int, minor)
+        __field(int, timer)
+        __field(int, state)
+        __field(unsigned long, position_ms)
+    ),
+    TP_fast_assign(
+        __entry->minor = minor;
+        __entry->timer = timer;
+        __entry->state = state;
+        __entry->position_ms = position_ms;
+    ),
+    TP_printk("minor=%d timer=%s state=%s position_ms=%lu", __entry->minor,
+              __entry->timer == VIDEO_SIM_PLAY_TIMER ? "play" : "time_update",
+              show_video_state(__entry->state), __entry->position_ms)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
@@ -15,34 +15,38 @@
 #include <linux/sched.h>
 #include <linux/list.h>
 #include <linux/kstrtox.h>
+#include <linux/idr.h>
+#include <linux/percpu.h>
+#include <linux/ktime.h>
+
+#include "domiot-sim.h"
+#include "domiot-sim-text.h"
+#include "domiot-sim-events.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
 
 #define DEVICE_NAME "video-sim"
 #define CLASS_NAME "video"
-#define MAX_DEVICES 10
+#define MAX_DEVICES 1024
 #define VIDEO_MAX_CHARS 1024
 #define PLAY_DURATION_SECONDS 20
 #define MAX_PATH_LENGTH 1000
 
-// compatibility macros
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
-    #define CLASS_CREATE_COMPAT(name) class_create(name)
-#else
-    #define CLASS_CREATE_COMPAT(name) class_create(THIS_MODULE, name)
-#endif
-
 // debug: 0=errors only, 1=+init/cleanup, 2=+operations, 3=+verbose
 static int debug_level = 1;
 module_param(debug_level, int, 0644);
 MODULE_PARM_DESC(debug_level, "Debug level: 0=errors, 1=init/cleanup, 2=operations, 3=verbose (default: 1)");
 
+#ifdef DOMIOT_SIM_BUNDLE
+// set from the video parameter of domiot-sim.ko
+extern int domiot_sim_video;
+#define num_devices domiot_sim_video
+#else
 static int num_devices = 1;
 module_param(num_devices, int, S_IRUGO);
-MODULE_PARM_DESC(num_devices, "Number of video devices to create (default: 1, max: 10)");
-
-// debug macros to reduce overhead
-#define dbg_err(fmt, ...) printk(KERN_ERR "video-sim: " fmt, ##__VA_ARGS__)
-#define dbg_info(level, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "video-sim: " fmt, ##__VA_ARGS__); } while(0)
-#define dbg_dev_info(level, dev_id, fmt, ...) do { if (debug_level >= level) printk(KERN_INFO "video-sim%d: " fmt, dev_id, ##__VA_ARGS__); } while(0)
+MODULE_PARM_DESC(num_devices, "Number of video devices to create at load time (default: 1, max: 1024)");
+#endif
 
 enum video_state {
     VIDEO_STOPPED,
@@ -50,26 +54,42 @@ enum video_state {
     VIDEO_PAUSED
 };
 
+// operation counters, per CPU so that the timers, readers and writers never
+// share a cache line; the stats attributes sum them over all CPUs
+struct video_stats {
+    u64 reads;
+    u64 writes;
+    u64 bytes_in;
+    u64 bytes_out;
+    u64 state_changes;  // play, pause, stop and end transitions
+    u64 wakeups;        // notifications of the readers by the timers
+    u64 eagain;
+};
+
 struct video_sim_reader {
-    struct list_head list;
-    wait_queue_head_t wait;
-    int data_available;
     struct video_device *device;
+    // generation of the last update this reader has read
+    u64 seen_generation;
 };
 
 struct video_device {
     dev_t dev_num;
-    struct cdev cdev;
     struct device *device;
     int minor;
+    // open files, delete_device is refused while non-zero
+    unsigned int open_count;
     char current_text[VIDEO_MAX_CHARS + 1];
     struct mutex text_mutex;
+    char command[VIDEO_MAX_CHARS + 1];  // text of the write being handled, under state_mutex
     struct timer_list play_timer;
     struct timer_list time_update_timer;
-    struct list_head readers_list;
-    spinlock_t readers_lock;
+    // readers sleep until the generation moves past their seen_generation
+    struct dsim_notifier notify;
     enum video_state state;
     struct mutex state_mutex;
+    // numbers the state changes for the event bus, bumped under state_mutex
+    // by device_write() and the play timer
+    atomic64_t state_seq;
     char video_src[MAX_PATH_LENGTH];
     int src_loaded;
     unsigned long pause_time;
@@ -78,11 +98,19 @@ struct video_device {
     unsigned long current_position_ms;
     int video_ended;
     int loop_enabled;
+    struct video_stats __percpu *stats;
 };
 
 static int major_number;
 static struct class *video_class = NULL;
-static struct video_device *devices = NULL;
+// readers are allocated on every open, from a dedicated cache
+static struct kmem_cache *reader_cache;
+static struct cdev video_cdev;
+// devices by minor, devices_mutex protects the table and open_count
+static DEFINE_IDR(devices_idr);
+static DEFINE_MUTEX(devices_mutex);
+// state change events of all the devices, see domiot-sim-events.h
+static struct dsim_events *event_bus;
 
 static int device_open(struct inode *, struct file *);
 static int device_release(struct inode *, struct file *);
@@ -98,13 +126,49 @@ static struct file_operations fops = {
     .poll = device_poll,
 };
 
+#define STATS_ATTR(field) DSIM_STATS_ATTR(struct video_device, struct video_stats, field)
+
+STATS_ATTR(reads);
+STATS_ATTR(writes);
+STATS_ATTR(bytes_in);
+STATS_ATTR(bytes_out);
+STATS_ATTR(state_changes);
+STATS_ATTR(wakeups);
+STATS_ATTR(eagain);
+
+static struct attribute *video_stats_attrs[] = {
+    &dev_attr_stats_reads.attr,
+    &dev_attr_stats_writes.attr,
+    &dev_attr_stats_bytes_in.attr,
+    &dev_attr_stats_bytes_out.attr,
+    &dev_attr_stats_state_changes.attr,
+    &dev_attr_stats_wakeups.attr,
+    &dev_attr_stats_eagain.attr,
+    NULL,
+};
+
+// /sys/class/video/video-simN/stats/
+static const struct attribute_group video_stats_group = {
+    .name = "stats",
+    .attrs = video_stats_attrs,
+};
+
+// a new position or the end for every reader
+static void notify_readers(struct video_device *dev)
+{
+    dsim_publish(&dev->notify);
+    dsim_wake(&dev->notify);
+    this_cpu_inc(dev->stats->wakeups);
+}
+
 static void read_timer_callback(struct timer_list *t)
 {
     struct video_device *dev = from_timer(dev, t, play_timer);
-    struct video_sim_reader *reader;
     
     mutex_lock(&dev->state_mutex);
     
+    trace_video_sim_timer(dev->minor, VIDEO_SIM_PLAY_TIMER, dev->state, dev->current_position_ms);
+    
     if (dev->state == VIDEO_PLAYING) {
         dbg_dev_info(2, dev->minor, "Play timer expired - video %s\n", 
                      dev->loop_enabled ? "restarting (loop enabled)" : "ended");
@@ -120,17 +184,15 @@ static void read_timer_callback(struct timer_list *t)
             mod_timer(&dev->time_update_timer, jiffies + msecs_to_jiffies(100));
             
             // Wake up readers for the restart (position reset to 0.0)
-            spin_lock(&dev->readers_lock);
-            list_for_each_entry(reader, &dev->readers_list, list) {
-                reader->data_available = 1;
-                wake_up_interruptible(&reader->wait);
-            }
-            spin_unlock(&dev->readers_lock);
+            notify_readers(dev);
             
             dbg_dev_info(2, dev->minor, "Video restarted due to loop - notified readers\n");
         } else {
             // Normal end behavior
+            trace_video_sim_state_change(dev->minor, dev->state, VIDEO_STOPPED, PLAY_DURATION_SECONDS * 1000);
+            this_cpu_inc(dev->stats->state_changes);
             dev->state = VIDEO_STOPPED;
+            dsim_event(event_bus, dev->minor, atomic64_inc_return(&dev->state_seq), ktime_get_ns(), VIDEO_STOPPED);
             dev->remaining_time_ms = PLAY_DURATION_SECONDS * 1000; // Reset for next play
             dev->current_position_ms = PLAY_DURATION_SECONDS * 1000; // Set to end position
             dev->video_ended = 1;
@@ -139,12 +201,7 @@ static void read_timer_callback(struct timer_list *t)
             del_timer(&dev->time_update_timer);
             
             // Wake up all waiting readers
-            spin_lock(&dev->readers_lock);
-            list_for_each_entry(reader, &dev->readers_list, list) {
-                reader->data_available = 1;
-                wake_up_interruptible(&reader->wait);
-            }
-            spin_unlock(&dev->readers_lock);
+            notify_readers(dev);
             
             dbg_dev_info(2, dev->minor, "Notified all readers that video ended\n");
         }
@@ -156,18 +213,14 @@ static void read_timer_callback(struct timer_list *t)
 static void time_update_callback(struct timer_list *t)
 {
     struct video_device *dev = from_timer(dev, t, time_update_timer);
-    struct video_sim_reader *reader;
     
     mutex_lock(&dev->state_mutex);
     
+    trace_video_sim_timer(dev->minor, VIDEO_SIM_TIME_UPDATE_TIMER, dev->state, dev->current_position_ms);
+    
     if (dev->state == VIDEO_PLAYING) {
         // Wake up all waiting readers for the current time
-        spin_lock(&dev->readers_lock);
-        list_for_each_entry(reader, &dev->readers_list, list) {
-            reader->data_available = 1;
-            wake_up_interruptible(&reader->wait);
-        }
-        spin_unlock(&dev->readers_lock);
+        notify_readers(dev);
         
         // Schedule next update in 100ms if still playing and not at end
         if (dev->current_position_ms < PLAY_DURATION_SECONDS * 1000) {
@@ -190,53 +243,62 @@ static int device_open(struct inode *inodep, struct file *filep)
 {
     int minor = iminor(inodep);
     struct video_sim_reader *reader;
+    struct video_device *dev;
     
-    if (minor >= num_devices) {
+    // keep the device from being deleted while it is open
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, minor);
+    if (dev) {
+        dev->open_count++;
+    }
+    mutex_unlock(&devices_mutex);
+    if (!dev) {
         dbg_err("Invalid minor number %d\n", minor);
         return -ENODEV;
     }
     
     // For reading, create a reader structure
     if (filep->f_mode & FMODE_READ) {
-        reader = kmalloc(sizeof(struct video_sim_reader), GFP_KERNEL);
+        reader = kmem_cache_alloc(reader_cache, GFP_KERNEL);
         if (!reader) {
+            mutex_lock(&devices_mutex);
+            dev->open_count--;
+            mutex_unlock(&devices_mutex);
             return -ENOMEM;
         }
         
-        init_waitqueue_head(&reader->wait);
-        reader->data_available = 0; // No data available initially
-        reader->device = &devices[minor];
+        // No data available initially, the first read waits for an update
+        reader->device = dev;
+        reader->seen_generation = dsim_generation(&dev->notify);
         
         // Reset video ended flag and position when a new reader opens
-        mutex_lock(&devices[minor].state_mutex);
-        devices[minor].video_ended = 0;
-        if (devices[minor].state == VIDEO_STOPPED) {
-            devices[minor].current_position_ms = 0;
+        mutex_lock(&dev->state_mutex);
+        dev->video_ended = 0;
+        if (dev->state == VIDEO_STOPPED) {
+            dev->current_position_ms = 0;
         }
-        mutex_unlock(&devices[minor].state_mutex);
-        
-        spin_lock(&devices[minor].readers_lock);
-        list_add(&reader->list, &devices[minor].readers_list);
-        spin_unlock(&devices[minor].readers_lock);
+        mutex_unlock(&dev->state_mutex);
         
         filep->private_data = reader;
         dbg_dev_info(2, minor, "Video device opened for reading\n");
     } else {
-        filep->private_data = &devices[minor];
+        filep->private_data = dev;
         dbg_dev_info(2, minor, "Video device opened for writing\n");
     }
     
+    trace_video_sim_open(minor, !!(filep->f_mode & FMODE_READ));
     return 0;
 }
 
 static ssize_t device_write(struct file *filep, const char *buffer, size_t len, loff_t *offset)
 {
     struct video_device *dev;
-    char *user_input = NULL;
-    static char processed_text[VIDEO_MAX_CHARS + 1]; // Make static to reduce stack frame
-    int i, processed_len = 0;
-    size_t actual_len;
+    char *processed_text;
+    char chunk[64];
+    int processed_len = 0;
+    size_t actual_len, done = 0, n;
     const char *src_path;
+    enum video_state old_state;
     
     // Handle both reader and direct device access
     if (filep->f_mode & FMODE_READ) {
@@ -258,30 +320,22 @@ static ssize_t device_write(struct file *filep, const char *buffer, size_t len,
     // Limit to first 1024 characters as requested
     actual_len = len > VIDEO_MAX_CHARS ? VIDEO_MAX_CHARS : len;
     
-    user_input = kmalloc(actual_len + 1, GFP_KERNEL);
-    if (!user_input) {
-        dbg_err("Failed to allocate memory for user input\n");
-        return -ENOMEM;
-    }
-    
-    if (copy_from_user(user_input, buffer, actual_len)) {
-        kfree(user_input);
-        return -EFAULT;
-    }
-    user_input[actual_len] = '\0';
+    // writers are serialized by state_mutex, which also guards the command buffer
+    mutex_lock(&dev->state_mutex);
+    processed_text = dev->command;
+    processed_text[0] = '\0';
     
     // Process input text: take first 1024 characters, convert newlines to spaces
-    memset(processed_text, 0, sizeof(processed_text));
-    for (i = 0; i < actual_len && processed_len < VIDEO_MAX_CHARS; i++) {
-        if (user_input[i] == '\n' || user_input[i] == '\r') {
-            processed_text[processed_len] = ' ';
-            processed_len++;
-        } else if (user_input[i] >= 32 && user_input[i] <= 126) {
-            processed_text[processed_len] = user_input[i];
-            processed_len++;
+    while (done < actual_len) {
+        n = min(actual_len - done, sizeof(chunk));
+        if (copy_from_user(chunk, buffer + done, n)) {
+            mutex_unlock(&dev->state_mutex);
+            return -EFAULT;
         }
+        done += n;
+        processed_len += dsim_sanitize_text(chunk, n, processed_text + processed_len,
+                                            VIDEO_MAX_CHARS - processed_len);
     }
-    processed_text[processed_len] = '\0';
     
     // Remove trailing spaces and null terminate properly
     while (processed_len > 0 && processed_text[processed_len-1] == ' ') {
@@ -295,7 +349,7 @@ static ssize_t device_write(struct file *filep, const char *buffer, size_t len,
     mutex_unlock(&dev->text_mutex);
     
     // Process commands
-    mutex_lock(&dev->state_mutex);
+    old_state = dev->state;
     
     if (strcmp(processed_text, "PAUSE") == 0) {
         if (dev->state == VIDEO_PLAYING) {
@@ -416,47 +470,10 @@ static ssize_t device_write(struct file *filep, const char *buffer, size_t len,
         }
     } else if (strncmp(processed_text, "SET CURRENT_TIME=", 17) == 0) {
         // Extract time value after "SET CURRENT_TIME="
-        const char *time_str = processed_text + 17;
-        char *dot_pos = strchr(time_str, '.');
-        unsigned long seconds_part = 0;
-        unsigned long ms_part = 0;
         unsigned long new_position_ms = 0;
-        int valid_time = 0;
         
-        if (dot_pos) {
-            // Parse seconds.milliseconds format
-            char seconds_str[16] = {0};
-            char ms_str[8] = {0};
-            int seconds_len = dot_pos - time_str;
-            int ms_len = strlen(dot_pos + 1);
-            
-            if (seconds_len < 16 && ms_len <= 3) {
-                strncpy(seconds_str, time_str, seconds_len);
-                strncpy(ms_str, dot_pos + 1, ms_len);
-                
-                // Pad milliseconds to 3 digits
-                if (ms_len == 1) {
-                    strcat(ms_str, "00");  // .1 -> 100ms
-                } else if (ms_len == 2) {
-                    strcat(ms_str, "0");   // .12 -> 120ms
-                }
-                // .123 -> 123ms (already 3 digits)
-                
-                if (kstrtoul(seconds_str, 10, &seconds_part) == 0 && 
-                    kstrtoul(ms_str, 10, &ms_part) == 0) {
-                    new_position_ms = seconds_part * 1000 + ms_part;
-                    valid_time = 1;
-                }
-            }
-        } else {
-            // Parse integer seconds format
-            if (kstrtoul(time_str, 10, &seconds_part) == 0) {
-                new_position_ms = seconds_part * 1000;
-                valid_time = 1;
-            }
-        }
-        
-        if (valid_time && new_position_ms <= PLAY_DURATION_SECONDS * 1000) {
+        if (dsim_parse_current_time(processed_text + 17, &new_position_ms) == 0 &&
+            new_position_ms <= PLAY_DURATION_SECONDS * 1000) {
             unsigned long total_duration_ms = PLAY_DURATION_SECONDS * 1000;
             
             // Calculate remaining time from the new position
@@ -485,9 +502,17 @@ static ssize_t device_write(struct file *filep, const char *buffer, size_t len,
                      processed_text, processed_len, actual_len, len);
     }
     
+    if (dev->state != old_state) {
+        trace_video_sim_state_change(dev->minor, old_state, dev->state, dev->current_position_ms);
+        this_cpu_inc(dev->stats->state_changes);
+        dsim_event(event_bus, dev->minor, atomic64_inc_return(&dev->state_seq), ktime_get_ns(), dev->state);
+    }
+    this_cpu_inc(dev->stats->writes);
+    this_cpu_add(dev->stats->bytes_in, len);
+    trace_video_sim_write(dev->minor, dev->state, len);
+    
     mutex_unlock(&dev->state_mutex);
     
-    kfree(user_input);
     return len; // Return original length to indicate all was "processed"
 }
 
@@ -508,18 +533,22 @@ static ssize_t device_read(struct file *filep, char *buffer, size_t len, loff_t
     
     // Non-blocking mode
     if (filep->f_flags & O_NONBLOCK) {
-        if (!reader->data_available) {
+        if (!dsim_pending(&reader->device->notify, reader->seen_generation)) {
+            this_cpu_inc(reader->device->stats->eagain);
             return -EAGAIN;
         }
     } else {
         // Blocking mode - wait for data
-        if (wait_event_interruptible(reader->wait, reader->data_available)) {
+        if (wait_event_interruptible(reader->device->notify.wait,
+                                     dsim_pending(&reader->device->notify, reader->seen_generation))) {
             return -ERESTARTSYS;
         }
+        trace_video_sim_wakeup(reader->device->minor, READ_ONCE(reader->device->current_position_ms));
     }
     
-    // Reset data available flag
-    reader->data_available = 0;
+    // an update racing with the read bumps the generation again, so it is
+    // reported by the next read
+    WRITE_ONCE(reader->seen_generation, dsim_generation(&reader->device->notify));
     
     mutex_lock(&reader->device->state_mutex);
     
@@ -538,6 +567,9 @@ static ssize_t device_read(struct file *filep, char *buffer, size_t len, loff_t
             return -EFAULT;
         }
         
+        this_cpu_inc(reader->device->stats->reads);
+        this_cpu_add(reader->device->stats->bytes_out, message_len);
+        trace_video_sim_read(reader->device->minor, PLAY_DURATION_SECONDS * 1000, message_len);
         dbg_dev_info(2, reader->device->minor, "Read returned: END\r\n");
         return message_len;
     }
@@ -560,6 +592,9 @@ static ssize_t device_read(struct file *filep, char *buffer, size_t len, loff_t
         return -EFAULT;
     }
     
+    this_cpu_inc(reader->device->stats->reads);
+    this_cpu_add(reader->device->stats->bytes_out, message_len);
+    trace_video_sim_read(reader->device->minor, position_ms, message_len);
     dbg_dev_info(3, reader->device->minor, "Read returned: %s", time_message);
     
     return message_len;
@@ -573,10 +608,14 @@ static unsigned int device_poll(struct file *filep, struct poll_table_struct *wa
     if (!reader) {
         return POLLERR;
     }
+    // write-only files have the device, not a reader
+    if (!(filep->f_mode & FMODE_READ)) {
+        return POLLOUT | POLLWRNORM;
+    }
     
-    poll_wait(filep, &reader->wait, wait);
+    poll_wait(filep, &reader->device->notify.wait, wait);
     
-    if (reader->data_available) {
+    if (dsim_pending(&reader->device->notify, READ_ONCE(reader->seen_generation))) {
         mask |= POLLIN | POLLRDNORM;
     }
     
@@ -588,155 +627,287 @@ static unsigned int device_poll(struct file *filep, struct poll_table_struct *wa
 
 static int device_release(struct inode *inodep, struct file *filep)
 {
+    struct video_device *dev = NULL;
+    
     if (filep->f_mode & FMODE_READ) {
         struct video_sim_reader *reader = (struct video_sim_reader *)filep->private_data;
         if (reader && reader->device) {
-            spin_lock(&reader->device->readers_lock);
-            list_del(&reader->list);
-            spin_unlock(&reader->device->readers_lock);
-            
-            dbg_dev_info(2, reader->device->minor, "Video device closed (reader)\n");
-            kfree(reader);
+            dev = reader->device;
+            dbg_dev_info(2, dev->minor, "Video device closed (reader)\n");
+            kmem_cache_free(reader_cache, reader);
         }
     } else {
-        struct video_device *dev = (struct video_device *)filep->private_data;
+        dev = (struct video_device *)filep->private_data;
         if (dev) {
             dbg_dev_info(2, dev->minor, "Video device closed (writer)\n");
         }
     }
+    
+    if (dev) {
+        trace_video_sim_release(dev->minor, !!(filep->f_mode & FMODE_READ));
+        mutex_lock(&devices_mutex);
+        dev->open_count--;
+        mutex_unlock(&devices_mutex);
+    }
     return 0;
 }
 
+// caller holds devices_mutex
+static int create_device(int id)
+{
+    struct video_device *dev;
+    int result;
+    
+    dev = kzalloc(sizeof(struct video_device), GFP_KERNEL);
+    if (!dev) {
+        return -ENOMEM;
+    }
+    
+    dev->stats = alloc_percpu(struct video_stats);
+    if (!dev->stats) {
+        kfree(dev);
+        return -ENOMEM;
+    }
+    
+    result = idr_alloc(&devices_idr, dev, id, id + 1, GFP_KERNEL);
+    if (result < 0) {
+        free_percpu(dev->stats);
+        kfree(dev);
+        return result == -ENOSPC ? -EEXIST : result;
+    }
+    
+    // kzalloc cleared the text, source, position and loop (disabled) fields
+    dev->dev_num = MKDEV(major_number, id);
+    dev->minor = id;
+    mutex_init(&dev->text_mutex);
+    mutex_init(&dev->state_mutex);
+    dsim_notifier_init(&dev->notify);
+    dev->state = VIDEO_STOPPED;
+    dev->remaining_time_ms = PLAY_DURATION_SECONDS * 1000;
+    
+    // Setup the timers but don't start them yet
+    timer_setup(&dev->play_timer, read_timer_callback, 0);
+    timer_setup(&dev->time_update_timer, time_update_callback, 0);
+    
+    dev->device = device_create(video_class, NULL, dev->dev_num, dev, DEVICE_NAME "%d", id);
+    if (IS_ERR(dev->device)) {
+        dbg_err("Failed to create device %d\n", id);
+        result = PTR_ERR(dev->device);
+        goto cleanup_dev;
+    }
+    
+    result = sysfs_create_group(&dev->device->kobj, &video_stats_group);
+    if (result) {
+        dbg_err("Failed to create sysfs attributes for device %d\n", id);
+        device_destroy(video_class, dev->dev_num);
+        goto cleanup_dev;
+    }
+    
+    dbg_info(1, "Video device %d created: /dev/" DEVICE_NAME "%d (loop: disabled)\n", id, id);
+    return 0;
+    
+cleanup_dev:
+    idr_remove(&devices_idr, id);
+    mutex_destroy(&dev->text_mutex);
+    mutex_destroy(&dev->state_mutex);
+    free_percpu(dev->stats);
+    kfree(dev);
+    return result;
+}
+
+// caller holds devices_mutex, the device must not be open
+static void destroy_device(struct video_device *dev)
+{
+    int id = dev->minor;
+    
+    sysfs_remove_group(&dev->device->kobj, &video_stats_group);
+    device_destroy(video_class, dev->dev_num);
+    
+    // a video keeps playing after its files are closed, stop it so the
+    // timers do not re-arm each other
+    mutex_lock(&dev->state_mutex);
+    dev->state = VIDEO_STOPPED;
+    mutex_unlock(&dev->state_mutex);
+    del_timer_sync(&dev->play_timer);
+    del_timer_sync(&dev->time_update_timer);
+    
+    mutex_destroy(&dev->text_mutex);
+    mutex_destroy(&dev->state_mutex);
+    idr_remove(&devices_idr, id);
+    free_percpu(dev->stats);
+    kfree(dev);
+    
+    dbg_info(1, "Video device %d removed\n", id);
+}
+
+static void destroy_all_devices(void)
+{
+    struct video_device *dev;
+    int id;
+    
+    mutex_lock(&devices_mutex);
+    idr_for_each_entry(&devices_idr, dev, id) {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+}
+
+// echo N > /sys/class/video/new_device creates /dev/video-simN
+static ssize_t new_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    if (id < 0 || id >= MAX_DEVICES) return -EINVAL;
+    
+    mutex_lock(&devices_mutex);
+    ret = create_device(id);
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+// echo N > /sys/class/video/delete_device removes /dev/video-simN
+static ssize_t delete_device_store(CLASS_ATTR_CONST_COMPAT struct class *cls, CLASS_ATTR_CONST_COMPAT struct class_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    struct video_device *dev;
+    int id, ret;
+    
+    ret = kstrtoint(buf, 10, &id);
+    if (ret) return ret;
+    
+    mutex_lock(&devices_mutex);
+    dev = idr_find(&devices_idr, id);
+    if (!dev) {
+        ret = -ENODEV;
+    } else if (dev->open_count) {
+        ret = -EBUSY;
+    } else {
+        destroy_device(dev);
+    }
+    mutex_unlock(&devices_mutex);
+    
+    return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(new_device);
+static CLASS_ATTR_WO(delete_device);
+
 static int __init video_init(void)
 {
+    dev_t dev_num;
     int i, result;
     
-    if (num_devices <= 0 || num_devices > MAX_DEVICES) {
-        dbg_err("Invalid number of devices: %d (must be 1-%d)\n", num_devices, MAX_DEVICES);
+    if (num_devices < 0 || num_devices > MAX_DEVICES) {
+        dbg_err("Invalid number of devices: %d (must be 0-%d)\n", num_devices, MAX_DEVICES);
         return -EINVAL;
     }
     
     dbg_info(1, "Initializing %d video device(s)\n", num_devices);
     
-    result = alloc_chrdev_region(&major_number, 0, num_devices, DEVICE_NAME);
+    // minors are reserved for every possible device
+    result = alloc_chrdev_region(&dev_num, 0, MAX_DEVICES, DEVICE_NAME);
     if (result < 0) {
         dbg_err("Failed to allocate major number\n");
         return result;
     }
-    major_number = MAJOR(major_number);
+    major_number = MAJOR(dev_num);
     dbg_info(1, "Registered correctly with major number %d\n", major_number);
     
+    // one cdev covers the whole minor range, open() looks the device up
+    cdev_init(&video_cdev, &fops);
+    video_cdev.owner = THIS_MODULE;
+    result = cdev_add(&video_cdev, dev_num, MAX_DEVICES);
+    if (result) {
+        dbg_err("Failed to add cdev\n");
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
+        return result;
+    }
+    
     video_class = CLASS_CREATE_COMPAT(CLASS_NAME);
     if (IS_ERR(video_class)) {
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+        cdev_del(&video_cdev);
+        unregister_chrdev_region(dev_num, MAX_DEVICES);
         dbg_err("Failed to create device class\n");
         return PTR_ERR(video_class);
     }
     dbg_info(1, "Device class created correctly\n");
     
-    devices = kcalloc(num_devices, sizeof(struct video_device), GFP_KERNEL);
-    if (!devices) {
-        class_destroy(video_class);
-        unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
-        dbg_err("Failed to allocate memory for devices\n");
-        return -ENOMEM;
+    reader_cache = KMEM_CACHE(video_sim_reader, 0);
+    if (!reader_cache) {
+        result = -ENOMEM;
+        goto cleanup_devices;
     }
     
-    for (i = 0; i < num_devices; i++) {
-        devices[i].dev_num = MKDEV(major_number, i);
-        devices[i].minor = i;
-        mutex_init(&devices[i].text_mutex);
-        mutex_init(&devices[i].state_mutex);
-        INIT_LIST_HEAD(&devices[i].readers_list);
-        spin_lock_init(&devices[i].readers_lock);
-        devices[i].state = VIDEO_STOPPED;
-        devices[i].src_loaded = 0;
-        devices[i].remaining_time_ms = PLAY_DURATION_SECONDS * 1000;
-        devices[i].current_position_ms = 0;
-        devices[i].video_ended = 0;
-        devices[i].pause_time = 0;
-        devices[i].play_start_time = 0;
-        devices[i].loop_enabled = 0; // Default: loop disabled
-        memset(devices[i].video_src, 0, MAX_PATH_LENGTH);
-        
-        // Initialize video with empty text
-        memset(devices[i].current_text, 0, sizeof(devices[i].current_text));
-        
-        cdev_init(&devices[i].cdev, &fops);
-        result = cdev_add(&devices[i].cdev, devices[i].dev_num, 1);
-        if (result) {
-            dbg_err("Failed to add device %d\n", i);
-            goto cleanup_devices;
-        }
-        
-        devices[i].device = device_create(video_class, NULL, devices[i].dev_num, NULL, DEVICE_NAME "%d", i);
-        if (IS_ERR(devices[i].device)) {
-            cdev_del(&devices[i].cdev);
-            dbg_err("Failed to create device %d\n", i);
-            result = PTR_ERR(devices[i].device);
-            goto cleanup_devices;
-        }
-        
-        // Setup the timers but don't start them yet
-        timer_setup(&devices[i].play_timer, read_timer_callback, 0);
-        timer_setup(&devices[i].time_update_timer, time_update_callback, 0);
-        
-        dbg_info(1, "Video device %d created: /dev/" DEVICE_NAME "%d (loop: disabled)\n", i, i);
+    event_bus = dsim_events_register("video_sim", DSIM_EVENTS_VIDEO);
+    if (IS_ERR(event_bus)) {
+        result = PTR_ERR(event_bus);
+        dbg_err("Failed to register the events family\n");
+        goto cleanup_devices;
+    }
+    
+    // create the initial devices, more can be added through new_device
+    result = 0;
+    mutex_lock(&devices_mutex);
+    for (i = 0; i < num_devices && !result; i++) {
+        result = create_device(i);
+    }
+    mutex_unlock(&devices_mutex);
+    if (result) {
+        goto cleanup_devices;
+    }
+    
+    result = class_create_file(video_class, &class_attr_new_device);
+    if (result) {
+        goto cleanup_devices;
+    }
+    result = class_create_file(video_class, &class_attr_delete_device);
+    if (result) {
+        class_remove_file(video_class, &class_attr_new_device);
+        goto cleanup_devices;
     }
     
     dbg_info(1, "Video-sim driver loaded successfully\n");
     return 0;
 
 cleanup_devices:
-    for (i = i - 1; i >= 0; i--) {
-        del_timer(&devices[i].play_timer);
-        del_timer(&devices[i].time_update_timer);
-        device_destroy(video_class, devices[i].dev_num);
-        cdev_del(&devices[i].cdev);
-    }
-    kfree(devices);
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    kmem_cache_destroy(reader_cache);
     class_destroy(video_class);
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&video_cdev);
+    unregister_chrdev_region(dev_num, MAX_DEVICES);
     return result;
 }
 
-static void __exit video_exit(void)
+static void __dsim_exit video_exit(void)
 {
-    struct video_sim_reader *reader, *tmp;
-    int i;
-    
     dbg_info(1, "Unloading video-sim driver\n");
     
-    if (devices) {
-        for (i = 0; i < num_devices; i++) {
-            del_timer(&devices[i].play_timer);
-            del_timer(&devices[i].time_update_timer);
-            
-            // Clean up any remaining readers
-            spin_lock(&devices[i].readers_lock);
-            list_for_each_entry_safe(reader, tmp, &devices[i].readers_list, list) {
-                list_del(&reader->list);
-                kfree(reader);
-            }
-            spin_unlock(&devices[i].readers_lock);
-            
-            device_destroy(video_class, devices[i].dev_num);
-            cdev_del(&devices[i].cdev);
-        }
-        kfree(devices);
-    }
+    class_remove_file(video_class, &class_attr_delete_device);
+    class_remove_file(video_class, &class_attr_new_device);
+    
+    // no file can be open here, the module is pinned while one is
+    destroy_all_devices();
+    dsim_events_unregister(event_bus);
+    idr_destroy(&devices_idr);
+    kmem_cache_destroy(reader_cache);
     
     if (video_class) {
         class_destroy(video_class);
     }
     
-    unregister_chrdev_region(MKDEV(major_number, 0), num_devices);
+    cdev_del(&video_cdev);
+    unregister_chrdev_region(MKDEV(major_number, 0), MAX_DEVICES);
     
     dbg_info(1, "Video-sim driver unloaded\n");
 }
 
-module_init(video_init);
-module_exit(video_exit);
+DSIM_MODULE(video, video_init, video_exit)
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("DOMIoT");